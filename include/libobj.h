@@ -1,11 +1,33 @@
 #ifndef LIBOBJ_OBJ_H
 #define LIBOBJ_OBJ_H
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <iomanip>
 #include <iostream>
 #include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <sstream>
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <typeinfo>
+#include <unordered_map>
 #include <utility>
+#include <vector>
+
+#if defined(LIBOBJ_INTRUSIVE_REFCOUNT) && !defined(NDEBUG)                   \
+    && !defined(LIBOBJ_REFCOUNT_THREAD_CHECK)
+    #define LIBOBJ_REFCOUNT_THREAD_CHECK
+#endif
+
+#ifdef LIBOBJ_REFCOUNT_THREAD_CHECK
+    #include <thread>
+#endif
 
 #ifndef RTTI_ENABLED
     #if defined(__clang__)
@@ -23,6 +45,32 @@
     #endif
 #endif
 
+// the class a LIBOBJ_BASE macro is used in is checked at compile time, debug
+// builds with RTTI additionally check that the object being cloned is not of
+// a subclass that does not use one of the macros itself
+//
+// release builds skip the check, such a subclass is then sliced, clone(),
+// clone_into(), cloneInto(), cloneWithAllocator() and moves into an ObjBox
+// all produce an object of its base class
+#if defined(RTTI_ENABLED) && !defined(NDEBUG)                                 \
+    && !defined(LIBOBJ_CLONE_TYPE_CHECK)
+    #define LIBOBJ_CLONE_TYPE_CHECK
+#endif
+
+#if defined(LIBOBJ_CLONE_TYPE_CHECK) && !defined(RTTI_ENABLED)
+    #error LIBOBJ_CLONE_TYPE_CHECK needs RTTI
+#endif
+
+#ifdef LIBOBJ_CLONE_TYPE_CHECK
+    #define LIBOBJ_CHECK_CLONE_TYPE(T)                                         \
+        if (typeid(*this) != typeid(T)) {                                      \
+            LibObj::Obj_Base::throwCloneTypeMismatch(this->getObjId(),         \
+                                                     typeid(T));               \
+        }
+#else
+    #define LIBOBJ_CHECK_CLONE_TYPE(T)
+#endif
+
 /*
 
 // covariant template
@@ -75,14 +123,32 @@ int main() {
 }
 */
 
+// the LIBOBJ_BASE macros cannot be used in a class local to a function, the
+// registration is a static data member and the nearest LibObj class is found
+// through friend declarations of new functions, a local class can have
+// neither, see the local_class test for what does not compile
 #define LIBOBJ_BASE_ABSTRACT(T)                                                \
     using Obj_Base::operator==; /* inherit == */                               \
     using Obj_Base::operator!=; /* inherit != */                               \
     using Obj_Base::from;       /* inherit templates */                        \
     using Obj_Base::clone_impl; /* inherit clone_impl */                       \
     using Obj_Base::clone;      /* inherit clone */                            \
-    std::size_t getObjBaseSize() const override {                              \
-        return sizeof(T);                                                      \
+    static inline const bool objTypeRegistered =                               \
+        LibObj::Obj_Registry::add<T>();                                        \
+    template <typename ObjDerived>                                             \
+    friend LibObj::Obj_Type_Tag<T> objSelfTag(const ObjDerived *, const T *);  \
+    template <typename ObjDerived>                                             \
+    friend typename std::enable_if<!std::is_same<ObjDerived, T>::value,        \
+                                   LibObj::Obj_Type_Tag<T>>::type              \
+    objParentTag(const ObjDerived *, const T *);                               \
+    const LibObj::Obj_TypeDescriptor & getObjTypeDescriptor() const override { \
+        using ObjSelf = std::remove_pointer_t<decltype(this)>;                 \
+        static_assert(std::is_same<T, std::remove_cv_t<ObjSelf>>::value,       \
+                      "the argument of the LIBOBJ_BASE macros must be the "    \
+                      "class they are used in");                               \
+        /* odr-use the registration so class templates register too */        \
+        (void) objTypeRegistered;                                              \
+        return LibObj::Obj_TypeDescriptorOf<T>;                                \
     }
 
 #define LIBOBJ_BASE_ABSTRACT_WITH_CUSTOM_CLONE(T)                              \
@@ -91,8 +157,22 @@ int main() {
     using Obj_Base::from;       /* inherit templates */                        \
     using Obj_Base::clone_impl; /* inherit clone_impl */                       \
     using Obj_Base::clone;      /* inherit clone */                            \
-    std::size_t getObjBaseSize() const override {                              \
-        return sizeof(T);                                                      \
+    static inline const bool objTypeRegistered =                               \
+        LibObj::Obj_Registry::add<T>();                                        \
+    template <typename ObjDerived>                                             \
+    friend LibObj::Obj_Type_Tag<T> objSelfTag(const ObjDerived *, const T *);  \
+    template <typename ObjDerived>                                             \
+    friend typename std::enable_if<!std::is_same<ObjDerived, T>::value,        \
+                                   LibObj::Obj_Type_Tag<T>>::type              \
+    objParentTag(const ObjDerived *, const T *);                               \
+    const LibObj::Obj_TypeDescriptor & getObjTypeDescriptor() const override { \
+        using ObjSelf = std::remove_pointer_t<decltype(this)>;                 \
+        static_assert(std::is_same<T, std::remove_cv_t<ObjSelf>>::value,       \
+                      "the argument of the LIBOBJ_BASE macros must be the "    \
+                      "class they are used in");                               \
+        /* odr-use the registration so class templates register too */        \
+        (void) objTypeRegistered;                                              \
+        return LibObj::Obj_TypeDescriptorOf<T>;                                \
     }                                                                          \
     void clone_impl(Obj_Base * ptr) const override {                           \
         clone_impl_actual(static_cast<T *>(ptr));                              \
@@ -104,27 +184,75 @@ int main() {
     using Obj_Base::operator!=; /* inherit != */                               \
     using Obj_Base::from;       /* inherit templates */                        \
     using Obj_Base::clone_impl; /* inherit clone_impl */                       \
-    std::size_t getObjBaseSize() const override {                              \
-        return sizeof(T);                                                      \
+    static inline const bool objTypeRegistered =                               \
+        LibObj::Obj_Registry::add<T>();                                        \
+    template <typename ObjDerived>                                             \
+    friend LibObj::Obj_Type_Tag<T> objSelfTag(const ObjDerived *, const T *);  \
+    template <typename ObjDerived>                                             \
+    friend typename std::enable_if<!std::is_same<ObjDerived, T>::value,        \
+                                   LibObj::Obj_Type_Tag<T>>::type              \
+    objParentTag(const ObjDerived *, const T *);                               \
+    const LibObj::Obj_TypeDescriptor & getObjTypeDescriptor() const override { \
+        using ObjSelf = std::remove_pointer_t<decltype(this)>;                 \
+        static_assert(std::is_same<T, std::remove_cv_t<ObjSelf>>::value,       \
+                      "the argument of the LIBOBJ_BASE macros must be the "    \
+                      "class they are used in");                               \
+        /* odr-use the registration so class templates register too */        \
+        (void) objTypeRegistered;                                              \
+        return LibObj::Obj_TypeDescriptorOf<T>;                                \
     }                                                                          \
     T * baseClone() const override {                                           \
         return new T();                                                        \
     }                                                                          \
-    T* clone() const override {                                         \
+    T * baseClone_into(void * buf, std::size_t cap) const override {           \
+        if (cap < sizeof(T)                                                    \
+            || reinterpret_cast<std::uintptr_t>(buf) % alignof(T) != 0) {      \
+            LibObj::Obj_Base::throwCloneStorageMismatch(                       \
+                this->getObjId(), sizeof(T), alignof(T), buf, cap);            \
+        }                                                                      \
+        return ::new (buf) T();                                                \
+    }                                                                          \
+    T * clone() const override {                                               \
+        LIBOBJ_CHECK_CLONE_TYPE(T)                                             \
         T * p = static_cast<T *>(baseClone());                                 \
-        auto t1 = this->getObjId();                                            \
-        auto t2 = p->getObjId();                                               \
-        if (t1 != t2) {                                                        \
-            delete p;                                                \
-            std::ostringstream o;                                              \
-            o << "class " << t1.name()                                         \
-              << " attempted to clone itself, but the resulting allocation "   \
-                 "type is class "                                              \
-              << t2.name();                                                    \
-            throw std::runtime_error(o.str());                                 \
+        try {                                                                  \
+            clone_impl(p);                                                     \
+        } catch (...) {                                                        \
+            delete p;                                                          \
+            throw;                                                             \
+        }                                                                      \
+        return p;                                                              \
+    }                                                                          \
+    T * clone_into(void * buf, std::size_t cap) const override {               \
+        LIBOBJ_CHECK_CLONE_TYPE(T)                                             \
+        T * p = static_cast<T *>(baseClone_into(buf, cap));                    \
+        /* the caller only owns the buffer once clone_into returns */          \
+        try {                                                                  \
+            clone_impl(p);                                                     \
+        } catch (...) {                                                        \
+            p->~T();                                                           \
+            throw;                                                             \
+        }                                                                      \
+        return p;                                                              \
+    }                                                                          \
+    T * cloneInto(LibObj::Obj_Arena & arena) const override {                  \
+        LIBOBJ_CHECK_CLONE_TYPE(T)                                             \
+        T * p = arena.template create<T>();                                    \
+        try {                                                                  \
+            clone_impl(p);                                                     \
+        } catch (...) {                                                        \
+            arena.destroyLast();                                               \
+            throw;                                                             \
         }                                                                      \
-        clone_impl(p);                                                         \
-        return p; \
+        return p;                                                              \
+    }                                                                          \
+    std::shared_ptr<Obj_Base> cloneWithAllocator(                              \
+        std::pmr::memory_resource * resource) const override {                 \
+        LIBOBJ_CHECK_CLONE_TYPE(T)                                             \
+        std::shared_ptr<T> p = std::allocate_shared<T>(                        \
+            std::pmr::polymorphic_allocator<T>(resource));                     \
+        clone_impl(p.get());                                                   \
+        return p;                                                              \
     }
 
 #define LIBOBJ_BASE_WITH_CUSTOM_CLONE(T)                                       \
@@ -132,27 +260,75 @@ int main() {
     using Obj_Base::operator!=; /* inherit != */                               \
     using Obj_Base::from;       /* inherit templates */                        \
     using Obj_Base::clone_impl; /* inherit clone_impl */                       \
-    std::size_t getObjBaseSize() const override {                              \
-        return sizeof(T);                                                      \
+    static inline const bool objTypeRegistered =                               \
+        LibObj::Obj_Registry::add<T>();                                        \
+    template <typename ObjDerived>                                             \
+    friend LibObj::Obj_Type_Tag<T> objSelfTag(const ObjDerived *, const T *);  \
+    template <typename ObjDerived>                                             \
+    friend typename std::enable_if<!std::is_same<ObjDerived, T>::value,        \
+                                   LibObj::Obj_Type_Tag<T>>::type              \
+    objParentTag(const ObjDerived *, const T *);                               \
+    const LibObj::Obj_TypeDescriptor & getObjTypeDescriptor() const override { \
+        using ObjSelf = std::remove_pointer_t<decltype(this)>;                 \
+        static_assert(std::is_same<T, std::remove_cv_t<ObjSelf>>::value,       \
+                      "the argument of the LIBOBJ_BASE macros must be the "    \
+                      "class they are used in");                               \
+        /* odr-use the registration so class templates register too */        \
+        (void) objTypeRegistered;                                              \
+        return LibObj::Obj_TypeDescriptorOf<T>;                                \
     }                                                                          \
     T * baseClone() const override {                                           \
         return new T();                                                        \
     }                                                                          \
-    T* clone() const override {                                         \
+    T * baseClone_into(void * buf, std::size_t cap) const override {           \
+        if (cap < sizeof(T)                                                    \
+            || reinterpret_cast<std::uintptr_t>(buf) % alignof(T) != 0) {      \
+            LibObj::Obj_Base::throwCloneStorageMismatch(                       \
+                this->getObjId(), sizeof(T), alignof(T), buf, cap);            \
+        }                                                                      \
+        return ::new (buf) T();                                                \
+    }                                                                          \
+    T * clone() const override {                                               \
+        LIBOBJ_CHECK_CLONE_TYPE(T)                                             \
         T * p = static_cast<T *>(baseClone());                                 \
-        auto t1 = this->getObjId();                                            \
-        auto t2 = p->getObjId();                                               \
-        if (t1 != t2) {                                                        \
-            delete p;                                                \
-            std::ostringstream o;                                              \
-            o << "class " << t1.name()                                         \
-              << " attempted to clone itself, but the resulting allocation "   \
-                 "type is class "                                              \
-              << t2.name();                                                    \
-            throw std::runtime_error(o.str());                                 \
+        try {                                                                  \
+            clone_impl(p);                                                     \
+        } catch (...) {                                                        \
+            delete p;                                                          \
+            throw;                                                             \
+        }                                                                      \
+        return p;                                                              \
+    }                                                                          \
+    T * clone_into(void * buf, std::size_t cap) const override {               \
+        LIBOBJ_CHECK_CLONE_TYPE(T)                                             \
+        T * p = static_cast<T *>(baseClone_into(buf, cap));                    \
+        /* the caller only owns the buffer once clone_into returns */          \
+        try {                                                                  \
+            clone_impl(p);                                                     \
+        } catch (...) {                                                        \
+            p->~T();                                                           \
+            throw;                                                             \
+        }                                                                      \
+        return p;                                                              \
+    }                                                                          \
+    T * cloneInto(LibObj::Obj_Arena & arena) const override {                  \
+        LIBOBJ_CHECK_CLONE_TYPE(T)                                             \
+        T * p = arena.template create<T>();                                    \
+        try {                                                                  \
+            clone_impl(p);                                                     \
+        } catch (...) {                                                        \
+            arena.destroyLast();                                               \
+            throw;                                                             \
         }                                                                      \
-        clone_impl(p);                                                         \
-        return p; \
+        return p;                                                              \
+    }                                                                          \
+    std::shared_ptr<Obj_Base> cloneWithAllocator(                              \
+        std::pmr::memory_resource * resource) const override {                 \
+        LIBOBJ_CHECK_CLONE_TYPE(T)                                             \
+        std::shared_ptr<T> p = std::allocate_shared<T>(                        \
+            std::pmr::polymorphic_allocator<T>(resource));                     \
+        clone_impl(p.get());                                                   \
+        return p;                                                              \
     }                                                                          \
                                                                                \
     void clone_impl(Obj_Base * ptr) const override {                           \
@@ -160,6 +336,24 @@ int main() {
     }                                                                          \
     void clone_impl_actual(T * obj) const
 
+// opt-in slab allocation for a class, place inside the class body
+//
+// every `new T()` (and therefore `baseClone()` and `clone()`) is served from
+// LibObj::Obj_Slab, and `delete` recycles the storage instead of freeing it
+//
+// the size handed to the slab is the size of the most derived class, which is
+// what getObjBaseSize() reports, so subclasses share the allocator as well
+#define LIBOBJ_SLAB_ALLOCATED(T)                                               \
+    static constexpr bool objSlabAllocated = true;                             \
+    static void * operator new(std::size_t size) {                             \
+        static_assert(alignof(T) <= LibObj::Obj_Slab::Granularity,             \
+                      "over-aligned types cannot be slab allocated");          \
+        return LibObj::Obj_Slab::allocate(size);                               \
+    }                                                                          \
+    static void operator delete(void * ptr, std::size_t size) noexcept {       \
+        LibObj::Obj_Slab::deallocate(ptr, size);                               \
+    }
+
 #define LIBOBJ_OVERRIDE__FROM_COPY                                             \
     void from(const Obj_Base & other) const override
 
@@ -168,59 +362,639 @@ int main() {
 #define LIBOBJ_OVERRIDE__EQUALS                                                \
     bool operator==(const Obj_Base & other) const override
 
+// operator== comparing the listed fields of T with ==, in order, stopping at
+// the first that differs, after the fields of its parent
+//
+//   LIBOBJ_OVERRIDE__EQUALS_FIELDS(Point, &Point::x, &Point::y)
+//
+// objects of different types are never equal, and objects that both keep a
+// hash code via LIBOBJ_OVERRIDE__CACHED_HASHCODE are first compared by it
+#define LIBOBJ_OVERRIDE__EQUALS_FIELDS(T, ...)                                 \
+    bool objFieldsEqual(const T & other) const {                               \
+        return LibObj::Obj_Equals::parent<LibObj::Obj_ParentOf<T>>(*this,      \
+                                                                   other)      \
+               && LibObj::Obj_Equals::fields(*this, other, __VA_ARGS__);       \
+    }                                                                          \
+    bool operator==(const Obj_Base & other) const override {                   \
+        if (this == &other) {                                                  \
+            return true;                                                       \
+        }                                                                      \
+        if (!getObjTypeDescriptor().sameClass(                                 \
+                other.getObjTypeDescriptor())) {                               \
+            return false;                                                      \
+        }                                                                      \
+        const T & o = static_cast<const T &>(other);                           \
+        return LibObj::Obj_Equals::sameCachedHash(*this, o)                    \
+               && objFieldsEqual(o);                                           \
+    }
+
 #define LIBOBJ_OVERRIDE__STREAM                                                \
     std::ostream & toStream(std::ostream & os) const override
 
 #define LIBOBJ_OVERRIDE__HASHCODE std::size_t hashCode() const override
 
+#define LIBOBJ_OVERRIDE__RESET void reset() const override
+
+// LIBOBJ_OVERRIDE__HASHCODE, except the body is only run again once
+// markDirty() has been called, every other call returns the kept result
+//
+// from() and every other function that changes what the hash code is
+// computed from must call markDirty()
+#define LIBOBJ_OVERRIDE__CACHED_HASHCODE(T)                                    \
+    mutable LibObj::Obj_HashCache objHashCache;                                \
+    void markDirty() const override {                                          \
+        objHashCache.clear();                                                  \
+        LibObj::Obj_ParentOf<T>::markDirty();                                  \
+    }                                                                          \
+    std::size_t hashCode() const override {                                    \
+        return objHashCache.get([this] { return computeHashCode(); });         \
+    }                                                                          \
+    std::size_t computeHashCode() const
+
 #define LIB_OBJ_ERROR_STRING                                                   \
     "attempting to assign a const pointer to a non-const pointer ( result of " \
     "[ T* = const T* ] would make [ T = const T ], cannot modify read-only "   \
     "variable )"
 
+// assigns the pointer other_.get_value_from_other to the pointer value_,
+// throwing if other_.other_is_const_func reports that it points to const and
+// value_ does not
+//
+// when both pointer types are known use LibObj::Obj_PointerAssign(), which
+// rejects dropping const at compile time, when a failure should not throw
+// use LIBOBJ_POINTER_TRY_ASSIGN
 #define LIBOBJ_POINTER_ASSIGN(other_base_class, other_, value_,                 \
                               other_is_const_func, get_value_from_other)       \
-    LibObj::Obj_Base_make_overload(                                            \
-        [this](const other_base_class & other, auto & v) ->                    \
-        typename std::enable_if<!std::is_const<decltype(v)>::value,            \
-                                void>::type {                                  \
-            if (other.other_is_const_func) {                                   \
-                throw std::runtime_error(                                      \
-                    std::string(LIB_OBJ_ERROR_STRING)                          \
-                    + ", this: " + this->getObjId().name()                     \
-                    + ", other: " + other.getObjId().name()                    \
-                    + ", func: " + __PRETTY_FUNCTION__);                       \
-            } else {                                                           \
-                v = static_cast<                                               \
-                    typename std::remove_reference<decltype(v)>::type>(        \
-                    const_cast<void *>(other.get_value_from_other));           \
-            }                                                                  \
-        },                                                                     \
-        [this](const other_base_class & other, auto & v) ->                    \
-        typename std::enable_if<std::is_const<decltype(v)>::value,             \
-                                void>::type {                                  \
-            v = static_cast<                                                   \
-                const typename std::remove_reference<decltype(v)>::type>(      \
-                other.get_value_from_other);                                   \
-        })(other_.as<other_base_class>(), value_);
+    {                                                                          \
+        const other_base_class & libobj_other =                                \
+            other_.as<other_base_class>();                                     \
+        using libobj_value =                                                   \
+            std::remove_pointer_t<std::remove_reference_t<decltype(value_)>>;  \
+        if constexpr (std::is_const<libobj_value>::value) {                    \
+            value_ = static_cast<libobj_value *>(                              \
+                libobj_other.get_value_from_other);                            \
+        } else if (libobj_other.other_is_const_func) {                         \
+            LibObj::Obj_Base::throwPointerAssignMismatch(                      \
+                this->getObjId(), libobj_other.getObjId(),                     \
+                __PRETTY_FUNCTION__);                                          \
+        } else {                                                               \
+            value_ = static_cast<libobj_value *>(                              \
+                const_cast<void *>(libobj_other.get_value_from_other));        \
+        }                                                                      \
+    }
+
+// the noexcept form of LIBOBJ_POINTER_ASSIGN, an expression that is false,
+// leaving value_ unchanged, if the pointer cannot be assigned
+//
+// other_.get_pointer_from_other returns an Obj_ErasedPointer, so the pointer
+// and whether it points to const take a single call
+#define LIBOBJ_POINTER_TRY_ASSIGN(other_base_class, other_, value_,             \
+                                  get_pointer_from_other)                      \
+    LibObj::Obj_TryPointerAssign(                                              \
+        value_, other_.as<other_base_class>().get_pointer_from_other)
 
 namespace LibObj {
 
+    // assigns from to to, where assigning a pointer to const to a pointer to
+    // non-const is a compile time error
+    template <typename T, typename U>
+    void Obj_PointerAssign(T *& to, U * from) noexcept {
+        static_assert(std::is_const<T>::value || !std::is_const<U>::value,
+                      LIB_OBJ_ERROR_STRING);
+        to = from;
+    }
+
+    // a pointer whose type is only known at run time
+    struct Obj_ErasedPointer {
+            const void * value;
+            bool isConst;
+    };
+
+    // assigns from to to, false, leaving to unchanged, if from points to
+    // const and to does not
+    template <typename T>
+    bool Obj_TryPointerAssign(T *& to, Obj_ErasedPointer from) noexcept {
+        if constexpr (std::is_const<T>::value) {
+            to = static_cast<T *>(from.value);
+        } else {
+            if (from.isConst) {
+                return false;
+            }
+            to = static_cast<T *>(const_cast<void *>(from.value));
+        }
+        return true;
+    }
+
+    // identifies a LibObj class without needing RTTI, the id is a hash of the
+    // class name, so it is a compile time constant and the same in every
+    // process built by the same compiler
+    using Obj_TypeId = std::uint64_t;
+
+    struct Obj_TypeName {
+            // the name of T as spelled by the compiler, fully qualified
+            template <typename T>
+            static constexpr std::string_view of() {
+#if defined(__clang__) || defined(__GNUC__)
+                // clang: "... Obj_TypeName::of() [T = X]"
+                // gcc:   "... Obj_TypeName::of() [with T = X; ...]"
+                std::string_view f = __PRETTY_FUNCTION__;
+                std::size_t start = f.find("T = ") + 4;
+                std::size_t end = f.find(';', start);
+                if (end == std::string_view::npos) {
+                    end = f.rfind(']');
+                }
+#elif defined(_MSC_VER)
+                // "... LibObj::Obj_TypeName::of<X>(void)"
+                std::string_view f = __FUNCSIG__;
+                std::size_t start = f.find("Obj_TypeName::of<") + 17;
+                std::size_t end = f.rfind(">(void)");
+#else
+    #error Unsupported compiler
+#endif
+                return f.substr(start, end - start);
+            }
+
+            // 64 bit FNV-1a
+            static constexpr Obj_TypeId hash(std::string_view name) {
+                Obj_TypeId h = 14695981039346656037ull;
+                for (char c : name) {
+                    h = (h ^ (unsigned char) c) * 1099511628211ull;
+                }
+                return h;
+            }
+
+            // whether a name returned by of() is that of a class in an
+            // anonymous namespace, as spelled by gcc, clang and msvc
+            static constexpr bool isAnonymous(std::string_view name) {
+                return name.find("{anonymous}") != std::string_view::npos
+                       || name.find("(anonymous namespace)")
+                              != std::string_view::npos
+                       || name.find("`anonymous namespace'")
+                              != std::string_view::npos;
+            }
+    };
+
+    struct Obj_Base;
+    struct Obj;
+
+    struct Obj_TypeDescriptor;
+
+    // the run time part of what Obj_Registry knows about a class
+    struct Obj_Registry_Entry {
+            const Obj_TypeDescriptor * type = nullptr;
+            // the name getObjId().name() reports, with RTTI this is the
+            // demangled name, which may be spelled differently from
+            // type->name
+            std::string_view demangledName;
+            // the preorder interval of the class in the inheritance tree of
+            // all registered classes, a class derives from this one if and
+            // only if its first lies in [first, last]
+            //
+            // renumbered as classes are registered, 0 until then, read
+            // them between two loads of numbering
+            std::atomic<std::uint32_t> first {0};
+            std::atomic<std::uint32_t> last {0};
+            // 1 + the row and column of the class in the table of
+            // Obj_Conversions, 0 if no conversion from or to it is registered
+            mutable std::atomic<std::uint32_t> conversionIndex {0};
+            // another class was registered under the same id, looking up
+            // the id or name throws
+            mutable std::atomic<bool> conflict {false};
+
+            // a sequence lock over first and last of every entry, odd while
+            // the registry renumbers, so a reader that loads the same even
+            // value before and after reading them saw one numbering
+            static std::atomic<std::uint32_t> numbering;
+    };
+
+    // the entry of T, filled in when T is registered
+    template <typename T>
+    inline Obj_Registry_Entry Obj_RegistryEntryOf;
+
+    template <typename T>
+    struct Obj_Type_Tag {
+            using type = T;
+    };
+
+    // the LIBOBJ_BASE macros declare hidden friend overloads of these for
+    // their class, so overload resolution on a pointer to T picks the
+    // nearest class set up via a macro, these are the fallbacks for when
+    // there is none
+    Obj_Type_Tag<Obj_Base> objSelfTag(...);
+    Obj_Type_Tag<Obj_Base> objParentTag(...);
+
+    // T if T is set up via one of the LIBOBJ_BASE macros, otherwise its
+    // nearest base class that is
+    template <typename T>
+    using Obj_SelfOf = typename decltype(objSelfTag(
+        static_cast<const T *>(nullptr),
+        static_cast<const T *>(nullptr)))::type;
+
+    // the nearest base class of T set up via one of the LIBOBJ_BASE macros,
+    // Obj_Base if there is none
+    template <typename T>
+    using Obj_ParentOf = typename decltype(objParentTag(
+        static_cast<const T *>(nullptr),
+        static_cast<const T *>(nullptr)))::type;
+
+    // everything a LibObj class records about itself, one constant per class
+    // set up via the LIBOBJ_BASE family of macros, reached from an object
+    // through the single virtual getObjTypeDescriptor()
+    //
+    // code handling many objects can read sizes, ids and flags from here as
+    // plain data, for example to group objects by type
+    struct Obj_TypeDescriptor {
+            // T is abstract, factory is nullptr
+            static constexpr std::uint32_t Abstract = 1u << 0;
+            // T is declared final
+            static constexpr std::uint32_t Final = 1u << 1;
+            // T is allocated from Obj_Slab, see LIBOBJ_SLAB_ALLOCATED
+            static constexpr std::uint32_t SlabAllocated = 1u << 2;
+            // T is declared in an anonymous namespace, a class of the same
+            // name and id may exist in another translation unit
+            static constexpr std::uint32_t Anonymous = 1u << 3;
+
+            Obj_TypeId id;
+            // the compile time name the id is derived from
+            std::string_view name;
+            std::size_t size;
+            std::size_t alignment;
+            // the nearest base class that is itself a LibObj class, nullptr
+            // for classes deriving from Obj_Base directly
+            const Obj_TypeDescriptor * parent;
+            // equivalent to baseClone(), the caller deletes the object
+            Obj_Base * (*factory)();
+            std::uint32_t flags;
+            Obj_Registry_Entry * entry;
+
+            bool is(std::uint32_t flag) const {
+                return (flags & flag) != 0;
+            }
+
+            // whether both describe the same class, a class seen by several
+            // shared libraries may have a descriptor in each, a class in an
+            // anonymous namespace has only one
+            bool sameClass(const Obj_TypeDescriptor & other) const {
+                return this == &other || (id == other.id && !is(Anonymous));
+            }
+
+            template <typename T>
+            static Obj_Base * construct() {
+                return new T();
+            }
+
+            template <typename T>
+            static constexpr Obj_Base * (*factoryOf())() {
+                if constexpr (std::is_abstract<T>::value) {
+                    return nullptr;
+                } else {
+                    return &construct<T>;
+                }
+            }
+
+            template <typename T, typename = void>
+            struct slabAllocated : std::false_type {};
+            template <typename T>
+            struct slabAllocated<T, decltype((void) T::objSlabAllocated)>
+                : std::true_type {};
+
+            template <typename T>
+            static constexpr const Obj_TypeDescriptor * parentOf();
+
+            template <typename T>
+            static constexpr Obj_TypeDescriptor of() {
+                return {Obj_TypeName::hash(Obj_TypeName::of<T>()),
+                        Obj_TypeName::of<T>(),
+                        sizeof(T),
+                        alignof(T),
+                        parentOf<T>(),
+                        factoryOf<T>(),
+                        (std::is_abstract<T>::value ? Abstract : 0)
+                            | (std::is_final<T>::value ? Final : 0)
+                            | (slabAllocated<T>::value ? SlabAllocated : 0)
+                            | (Obj_TypeName::isAnonymous(Obj_TypeName::of<T>())
+                                   ? Anonymous
+                                   : 0),
+                        &Obj_RegistryEntryOf<T>};
+            }
+    };
+
+    template <typename T>
+    inline constexpr Obj_TypeDescriptor Obj_TypeDescriptorOf =
+        Obj_TypeDescriptor::of<T>();
+
+    template <typename T>
+    constexpr const Obj_TypeDescriptor * Obj_TypeDescriptor::parentOf() {
+        if constexpr (std::is_same<Obj_ParentOf<T>, Obj_Base>::value) {
+            return nullptr;
+        } else {
+            return &Obj_TypeDescriptorOf<Obj_ParentOf<T>>;
+        }
+    }
+
+    template <typename T>
+    inline constexpr Obj_TypeId Obj_TypeIdOf =
+        Obj_TypeName::hash(Obj_TypeName::of<T>());
+
+    // a hash code that is computed once and kept until it is cleared, see
+    // LIBOBJ_OVERRIDE__CACHED_HASHCODE
+    //
+    // concurrent get() calls on an unchanged object are safe, they may each
+    // compute the hash code once
+    struct Obj_HashCache {
+            template <typename F>
+            std::size_t get(F && compute) const {
+                if (valid.load(std::memory_order_acquire)) {
+                    return value.load(std::memory_order_relaxed);
+                }
+                std::size_t hash = compute();
+                value.store(hash, std::memory_order_relaxed);
+                valid.store(true, std::memory_order_release);
+                return hash;
+            }
+
+            void clear() const {
+                valid.store(false, std::memory_order_relaxed);
+            }
+
+            // true and the hash code in hash if one is kept, never computes
+            bool peek(std::size_t & hash) const {
+                if (!valid.load(std::memory_order_acquire)) {
+                    return false;
+                }
+                hash = value.load(std::memory_order_relaxed);
+                return true;
+            }
+
+        private:
+            mutable std::atomic<bool> valid {false};
+            mutable std::atomic<std::size_t> value {0};
+    };
+
+    // the parts of LIBOBJ_OVERRIDE__EQUALS_FIELDS that are not spelled out in
+    // the macro, a and b are always of the same type T
+    struct Obj_Equals {
+            template <typename T, typename... Fields>
+            static bool fields(const T & a, const T & b, Fields... fields) {
+                return ((a.*fields == b.*fields) && ...);
+            }
+
+            // false if both objects keep a hash code of their own and the two
+            // differ, equal objects have equal hash codes
+            template <typename T>
+            static bool sameCachedHash(const T & a, const T & b) {
+                if constexpr (ownsHashCache<T>(0)) {
+                    std::size_t ha, hb;
+                    if (a.objHashCache.peek(ha) && b.objHashCache.peek(hb)) {
+                        return ha == hb;
+                    }
+                }
+                return true;
+            }
+
+            // the fields of the parent P of T, those declared via
+            // LIBOBJ_OVERRIDE__EQUALS_FIELDS are compared field by field, an
+            // operator== written by hand is called, and a parent that keeps
+            // the operator== of Obj_Base is compared by its own hashCode(),
+            // which is what its == compares, unless it keeps the hashCode()
+            // of Obj as well and so has no state to compare
+            template <typename P>
+            static bool parent(const P & a, const P & b) {
+                if constexpr (hasFields<P>(0)) {
+                    return a.P::objFieldsEqual(b);
+                } else if constexpr (!std::is_same<
+                                         decltype(&P::operator==),
+                                         bool (Obj_Base::*)(const Obj_Base &)
+                                             const>::value) {
+                    return a.P::operator==(b);
+                } else if constexpr (std::is_same<P, Obj_Base>::value
+                                     || std::is_same<decltype(&P::hashCode),
+                                                     std::size_t (Obj::*)()
+                                                         const>::value) {
+                    return true;
+                } else {
+                    return a.P::hashCode() == b.P::hashCode();
+                }
+            }
+
+        private:
+            template <typename T>
+            static constexpr auto ownsHashCache(int) -> decltype(
+                std::is_same<decltype(&T::objHashCache),
+                             Obj_HashCache T::*>::value) {
+                return std::is_same<decltype(&T::objHashCache),
+                                    Obj_HashCache T::*>::value;
+            }
+            template <typename T>
+            static constexpr bool ownsHashCache(...) {
+                return false;
+            }
+
+            template <typename T>
+            static constexpr auto hasFields(int)
+                -> decltype(std::declval<const T &>().objFieldsEqual(
+                                std::declval<const T &>()),
+                            bool()) {
+                return true;
+            }
+            template <typename T>
+            static constexpr bool hasFields(...) {
+                return false;
+            }
+    };
+
+    // a size-class freelist allocator for small objects
+    //
+    // sizes are rounded up to a multiple of Granularity, and every thread
+    // keeps a magazine of free blocks per size class, so allocating and
+    // freeing on one thread takes no locks
+    //
+    // a block freed on another thread than the one that allocated it is
+    // pushed onto a lock free stack of the allocating thread, which takes the
+    // stack over once its magazine runs dry, so producer / consumer pipelines
+    // keep recycling the same storage
+    //
+    // storage is carved from chunks that are retained for reuse for the
+    // lifetime of the process, sizes larger than MaxSize are forwarded to
+    // ::operator new
+    struct Obj_Slab {
+            static constexpr std::size_t Granularity = 16;
+            static constexpr std::size_t MaxSize = 512;
+
+            static void * allocate(std::size_t size);
+            static void deallocate(void * ptr, std::size_t size) noexcept;
+    };
+
+#ifdef LIBOBJ_INTRUSIVE_REFCOUNT
+    // ObjRef counts with atomic read-modify-writes by default
+    struct Obj_RefCount_Atomic {
+            struct Owner {
+                    void check() const {}
+            };
+
+            static void retain(std::atomic<std::size_t> & count) {
+                count.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            // returns true if this released the last reference
+            static bool release(std::atomic<std::size_t> & count) {
+                return count.fetch_sub(1, std::memory_order_acq_rel) == 1;
+            }
+    };
+
+    // for objects that never leave the thread that created them, counts
+    // with plain loads and stores instead of locked read-modify-writes
+    //
+    // when LIBOBJ_REFCOUNT_THREAD_CHECK is defined (the default unless
+    // NDEBUG is) every handle remembers the thread it was created on, and
+    // copying or destroying it on any other thread aborts, the macro must be
+    // defined the same way in every translation unit
+    struct Obj_RefCount_Local {
+            [[noreturn]] static void threadMismatch();
+
+#ifdef LIBOBJ_REFCOUNT_THREAD_CHECK
+            struct Owner {
+                    std::thread::id thread = std::this_thread::get_id();
+
+                    void check() const {
+                        if (thread != std::this_thread::get_id()) {
+                            threadMismatch();
+                        }
+                    }
+            };
+#else
+            struct Owner {
+                    void check() const {}
+            };
+#endif
+
+            static void retain(std::atomic<std::size_t> & count) {
+                count.store(count.load(std::memory_order_relaxed) + 1,
+                            std::memory_order_relaxed);
+            }
+
+            // returns true if this released the last reference
+            static bool release(std::atomic<std::size_t> & count) {
+                std::size_t remaining =
+                    count.load(std::memory_order_relaxed) - 1;
+                count.store(remaining, std::memory_order_relaxed);
+                return remaining == 0;
+            }
+    };
+
+    template <typename T, typename Policy = Obj_RefCount_Atomic>
+    struct ObjRef;
+
+    template <typename T>
+    using LocalObjRef = ObjRef<T, Obj_RefCount_Local>;
+#endif
+
+    template <typename T>
+    struct Obj_Batch;
+
+    // a bump allocator that owns every object created in it
+    //
+    // objects are never deleted one by one, reset() destroys every object in
+    // reverse order of creation, frees every chunk but the newest and rewinds
+    // the arena to the start of that one, so the storage of a whole object
+    // graph is reclaimed at once
+    //
+    // an arena is not thread safe
+    struct Obj_Arena {
+            explicit Obj_Arena(std::size_t chunkSize = 4096);
+            Obj_Arena(const Obj_Arena & other) = delete;
+            Obj_Arena(Obj_Arena && other) = delete;
+            Obj_Arena & operator=(const Obj_Arena & other) = delete;
+            Obj_Arena & operator=(Obj_Arena && other) = delete;
+            ~Obj_Arena();
+
+            void * allocate(std::size_t size, std::size_t alignment);
+
+            template <typename T, class... Args>
+            T * create(Args &&... args) {
+                static_assert(std::is_base_of<Obj_Base, T>::value,
+                              "template argument T must derive from Obj_Base ( "
+                              "T : public Obj )");
+                void * storage = allocate(sizeof(T), alignof(T));
+                // allocate the record up front so a constructor that throws
+                // leaves nothing half registered
+                Destructor * record = static_cast<Destructor *>(
+                    allocate(sizeof(Destructor), alignof(Destructor)));
+                T * obj = ::new (storage) T(std::forward<Args>(args)...);
+                record->obj = obj;
+                record->next = destructors;
+                destructors = record;
+                return obj;
+            }
+
+            void reset();
+
+            // destroys the object create() returned last and drops it from
+            // the arena, its storage is reclaimed by the next reset()
+            void destroyLast();
+
+        private:
+            struct Chunk {
+                    Chunk * next;
+                    std::size_t size;
+            };
+
+            struct Destructor {
+                    Obj_Base * obj;
+                    Destructor * next;
+            };
+
+            std::size_t chunkSize;
+            Chunk * chunks = nullptr;
+            char * cursor = nullptr;
+            char * end = nullptr;
+            Destructor * destructors = nullptr;
+    };
+
     struct Obj_Base {
             struct Obj_Base_ID {
+                    Obj_TypeId id;
+                    // the descriptor of the nearest LIBOBJ_BASE class, valid
+                    // before that class is registered
+                    const Obj_TypeDescriptor & type;
 #ifdef RTTI_ENABLED
-                    const std::type_info & id;
-#else
-                    const int id = 0;
+                    const std::type_info & info;
 #endif
 
                     Obj_Base_ID(const Obj_Base & base);
 
-                    std::string name() const;
+#ifdef RTTI_ENABLED
+                    // the interned demangled name of a type
+                    static std::string_view name(const std::type_info & info);
+#endif
+
+                    // the demangled name of the type, interned so the view
+                    // stays valid for the lifetime of the process and only
+                    // the first call for each type demangles, without RTTI
+                    // the compile time name of the descriptor
+                    std::string_view name() const;
+
+                    // name() as an owned string, which is what name()
+                    // returned before it was interned
+                    std::string nameString() const {
+                        return std::string(name());
+                    }
 
-                    bool operator==(const Obj_Base_ID & other);
+                    // compares the classes, and with RTTI the typeids as
+                    // well, so a subclass that does not use one of the
+                    // LIBOBJ_BASE macros, and shares the id of its base,
+                    // still differs
+                    bool operator==(const Obj_Base_ID & other) const {
+#ifdef RTTI_ENABLED
+                        return type.sameClass(other.type) && info == other.info;
+#else
+                        return type.sameClass(other.type);
+#endif
+                    }
 
-                    bool operator!=(const Obj_Base_ID & other);
+                    bool operator!=(const Obj_Base_ID & other) const {
+                        return !(*this == other);
+                    }
             };
 
             template <typename T, class... Args>
@@ -239,13 +1013,138 @@ namespace LibObj {
                 return std::make_shared<T>(std::forward<Args>(args)...);
             }
 
+            // the object and its control block are allocated with alloc
+            template <typename T, class Alloc, class... Args>
+            static std::shared_ptr<T> CreateWithAllocator(const Alloc & alloc,
+                                                          Args &&... args) {
+                static_assert(std::is_base_of<Obj_Base, T>::value,
+                              "template argument T must derive from Obj_Base ( "
+                              "T : public Obj )");
+                return std::allocate_shared<T>(alloc,
+                                               std::forward<Args>(args)...);
+            }
+
+            // the object and its control block are allocated with alloc
+            template <typename T, class Alloc, class... Args>
+            std::shared_ptr<T> createWithAllocator(const Alloc & alloc,
+                                                   Args &&... args) {
+                static_assert(std::is_base_of<Obj_Base, T>::value,
+                              "template argument T must derive from Obj_Base ( "
+                              "T : public Obj )");
+                return std::allocate_shared<T>(alloc,
+                                               std::forward<Args>(args)...);
+            }
+
+            // constructs n objects of type T, each from args, in a single
+            // allocation that also holds the one control block they share
+            template <typename T, class... Args>
+            static Obj_Batch<T> CreateN(std::size_t n, const Args &... args) {
+                return Obj_Batch<T>(n, args...);
+            }
+
+            // constructs n objects of type T, each from args, in a single
+            // allocation that also holds the one control block they share
+            template <typename T, class... Args>
+            Obj_Batch<T> createN(std::size_t n, const Args &... args) {
+                return Obj_Batch<T>(n, args...);
+            }
+
+            // the returned object is owned by the arena
+            template <typename T, class... Args>
+            static T * CreateIn(Obj_Arena & arena, Args &&... args) {
+                return arena.create<T>(std::forward<Args>(args)...);
+            }
+
+            // the returned object is owned by the arena
+            template <typename T, class... Args>
+            T * createIn(Obj_Arena & arena, Args &&... args) {
+                return arena.create<T>(std::forward<Args>(args)...);
+            }
+
+#ifdef LIBOBJ_INTRUSIVE_REFCOUNT
+            template <typename T, class... Args>
+            static ObjRef<T> CreateRef(Args &&... args) {
+                static_assert(std::is_base_of<Obj_Base, T>::value,
+                              "template argument T must derive from Obj_Base ( "
+                              "T : public Obj )");
+                return ObjRef<T>(new T(std::forward<Args>(args)...));
+            }
+
+            template <typename T, class... Args>
+            ObjRef<T> createRef(Args &&... args) {
+                static_assert(std::is_base_of<Obj_Base, T>::value,
+                              "template argument T must derive from Obj_Base ( "
+                              "T : public Obj )");
+                return ObjRef<T>(new T(std::forward<Args>(args)...));
+            }
+
+            // the returned handle must not be used by any other thread
+            template <typename T, class... Args>
+            static LocalObjRef<T> CreateLocal(Args &&... args) {
+                static_assert(std::is_base_of<Obj_Base, T>::value,
+                              "template argument T must derive from Obj_Base ( "
+                              "T : public Obj )");
+                return LocalObjRef<T>(new T(std::forward<Args>(args)...));
+            }
+
+            // the returned handle must not be used by any other thread
+            template <typename T, class... Args>
+            LocalObjRef<T> createLocal(Args &&... args) {
+                static_assert(std::is_base_of<Obj_Base, T>::value,
+                              "template argument T must derive from Obj_Base ( "
+                              "T : public Obj )");
+                return LocalObjRef<T>(new T(std::forward<Args>(args)...));
+            }
+#endif
+
             Obj_Base_ID getObjId() const;
 
-            virtual std::size_t getObjBaseSize() const = 0;
+            // the descriptor of the class of this object, every other query
+            // about the class of an object reads it
+            virtual const Obj_TypeDescriptor & getObjTypeDescriptor() const = 0;
+
+            Obj_TypeId getObjTypeId() const {
+                return getObjTypeDescriptor().id;
+            }
+
+            std::size_t getObjBaseSize() const {
+                return getObjTypeDescriptor().size;
+            }
+
+            std::size_t getObjBaseAlignment() const {
+                return getObjTypeDescriptor().alignment;
+            }
             virtual Obj_Base * baseClone() const = 0;
             virtual void clone_impl(Obj_Base * obj) const = 0;
             virtual Obj_Base * clone() const = 0;
 
+            // constructs a default object of the same type in buf, which
+            // must hold getObjBaseSize() bytes aligned to
+            // getObjBaseAlignment(), otherwise an error is thrown
+            virtual Obj_Base * baseClone_into(void * buf,
+                                              std::size_t cap) const = 0;
+
+            // clone() into buf instead of a heap allocation, the same
+            // requirements as for baseClone_into() apply
+            //
+            // the clone is destroyed by calling its destructor,
+            // `obj->~Obj_Base()`, never by `delete`
+            virtual Obj_Base * clone_into(void * buf,
+                                          std::size_t cap) const = 0;
+            // the returned object is owned by the arena
+            virtual Obj_Base * cloneInto(Obj_Arena & arena) const = 0;
+            // the clone and its control block are allocated from resource
+            virtual std::shared_ptr<Obj_Base>
+            cloneWithAllocator(std::pmr::memory_resource * resource) const = 0;
+
+            // the clone and its control block are allocated from alloc's
+            // memory resource
+            template <typename T>
+            std::shared_ptr<Obj_Base> cloneWithAllocator(
+                const std::pmr::polymorphic_allocator<T> & alloc) const {
+                return cloneWithAllocator(alloc.resource());
+            }
+
             template <typename U, typename std::enable_if<
                                       std::is_base_of<Obj_Base, U>::value,
                                       bool>::type = true>
@@ -258,16 +1157,47 @@ namespace LibObj {
             void from(std::shared_ptr<U> && other) const {
                 from(std::move(*other));
             }
+#ifdef LIBOBJ_INTRUSIVE_REFCOUNT
+            template <typename U, typename P,
+                      typename std::enable_if<
+                          std::is_base_of<Obj_Base, U>::value, bool>::type =
+                          true>
+            void from(const ObjRef<U, P> & other) const {
+                from(*other);
+            }
+            template <typename U, typename P,
+                      typename std::enable_if<
+                          std::is_base_of<Obj_Base, U>::value, bool>::type =
+                          true>
+            void from(ObjRef<U, P> && other) const {
+                from(std::move(*other));
+            }
+#endif
             virtual void from(const Obj_Base & other) const = 0;
             virtual void from(Obj_Base && other) const = 0;
+            // returns the object to the state of a freshly constructed one,
+            // so it can be reused (see ObjPool) instead of being destroyed
+            // and constructed again
+            //
+            // does nothing by default
+            virtual void reset() const;
+            // invalidates whatever the object caches about its state, such
+            // as a hash code kept by LIBOBJ_OVERRIDE__CACHED_HASHCODE, from()
+            // and every other function that changes the object call it
+            //
+            // does nothing by default
+            virtual void markDirty() const {}
             virtual std::ostream & toStream(std::ostream & os) const;
             virtual std::size_t hashCode() const = 0;
             std::string toString() const;
 
+            // true for the same object, false for objects of different
+            // types, otherwise compares hashCode(), so classes with state
+            // should override it, see LIBOBJ_OVERRIDE__EQUALS_FIELDS
             virtual bool operator==(const Obj_Base & other) const;
 
             template <typename T, typename std::enable_if<!std::is_pointer<T>::value,bool>::type = true>
-            const T & as() const {
+            const T & as() const noexcept {
                 static_assert(std::is_base_of<Obj_Base, T>::value,
                               "template argument T must derive from Obj_Base ( "
                               "T : public Obj )");
@@ -275,14 +1205,91 @@ namespace LibObj {
             }
 
             template <typename T, typename std::enable_if<std::is_pointer<T>::value,bool>::type = true>
-            const T as() const {
+            const T as() const noexcept {
                 static_assert(std::is_base_of<Obj_Base, typename std::remove_pointer<T>::type>::value,
                               "template argument T must derive from Obj_Base ( "
                               "T : public Obj )");
                 return static_cast<T>(this);
             }
 
+            // true if this is a T, or derives from T, checked with two
+            // integer compares on the preorder numbering of Obj_Registry
+            //
+            // T must be set up via one of the LIBOBJ_BASE macros
+            template <typename T>
+            bool is() const {
+                static_assert(std::is_base_of<Obj_Base, T>::value,
+                              "template argument T must derive from Obj_Base ( "
+                              "T : public Obj )");
+                if constexpr (std::is_same<T, Obj_Base>::value) {
+                    return true;
+                } else {
+                    static_assert(std::is_same<Obj_SelfOf<T>, T>::value,
+                                  "template argument T must be set up via one "
+                                  "of the LIBOBJ_BASE macros");
+                    // odr-use the registration of T in case no T is ever
+                    // constructed
+                    (void) T::objTypeRegistered;
+                    const Obj_Registry_Entry & target = Obj_RegistryEntryOf<T>;
+                    const Obj_Registry_Entry & entry =
+                        *getObjTypeDescriptor().entry;
+                    std::atomic<std::uint32_t> & numbering =
+                        Obj_Registry_Entry::numbering;
+                    for (;;) {
+                        std::uint32_t version =
+                            numbering.load(std::memory_order_acquire);
+                        std::uint32_t first =
+                            target.first.load(std::memory_order_relaxed);
+                        std::uint32_t span =
+                            target.last.load(std::memory_order_relaxed)
+                            - first;
+                        std::uint32_t self =
+                            entry.first.load(std::memory_order_relaxed);
+                        std::atomic_thread_fence(std::memory_order_acquire);
+                        // retried if a class was registered meanwhile
+                        if ((version & 1) == 0
+                            && numbering.load(std::memory_order_relaxed)
+                                   == version) {
+                            return self - first <= span;
+                        }
+                    }
+                }
+            }
+
+            // a checked as(), nullptr if this is not a T
+            template <typename T>
+            const T * obj_cast() const {
+                return is<T>() ? static_cast<const T *>(this) : nullptr;
+            }
+
             bool operator!=(const Obj_Base & other) const;
+
+            // the error path of LIBOBJ_POINTER_ASSIGN
+            [[noreturn]] static void
+            throwPointerAssignMismatch(const Obj_Base_ID & self,
+                                       const Obj_Base_ID & other,
+                                       const char * func);
+
+            // the error path of constructing an ObjVariant from an object of
+            // a class it does not hold
+            [[noreturn]] static void
+            throwVariantTypeMismatch(const Obj_Base_ID & obj);
+
+#ifdef RTTI_ENABLED
+            // the error path of LIBOBJ_CHECK_CLONE_TYPE, declared whenever
+            // RTTI is on, so code checking clones links against a library
+            // built without the check
+            [[noreturn]] static void
+            throwCloneTypeMismatch(const Obj_Base_ID & self,
+                                   const std::type_info & clone);
+#endif
+
+            // the error path of baseClone_into() and clone_into()
+            [[noreturn]] static void
+            throwCloneStorageMismatch(const Obj_Base_ID & self,
+                                      std::size_t size, std::size_t alignment,
+                                      const void * buf, std::size_t cap);
+
             Obj_Base() = default;
             Obj_Base(const Obj_Base & other) = delete;
             Obj_Base(Obj_Base && other) = delete;
@@ -290,29 +1297,147 @@ namespace LibObj {
             Obj_Base & operator=(Obj_Base && other) = delete;
             virtual ~Obj_Base() {}
 
+#ifdef LIBOBJ_INTRUSIVE_REFCOUNT
+        private:
+            template <typename T, typename Policy>
+            friend struct ObjRef;
+
+            // the number of ObjRef handles referring to this object
+            mutable std::atomic<std::size_t> objRefCount {0};
+
+        public:
+#endif
+
+            // combines values into a hash with a 64 bit multiply and fold mixer
+            // in the style of wyhash, so that every input bit affects every
+            // output bit, even for values whose std::hash is the identity,
+            // such as integers and pointers
             struct HashCodeBuilder {
 
-                    std::size_t hash = 1;
+                    static constexpr std::uint64_t P0 = 0xa0761d6478bd642full;
+                    static constexpr std::uint64_t P1 = 0xe7037ed1a0b428dbull;
+                    static constexpr std::uint64_t P2 = 0x8ebc6af09c88c6dbull;
+                    static constexpr std::uint64_t P3 = 0x589965cc75cd93c7ull;
 
-                    template <typename U,
-                              typename std::enable_if<
-                                  std::is_base_of<Obj_Base, U>::value,
-                                  bool>::type = true>
-                    HashCodeBuilder & add(const U & obj) {
-                        hash = 31 * hash + obj.hashCode();
-                        return *this;
-                    }
+                    std::size_t hash = P3;
 
-                    template <typename U,
+                    // the 128 bit product of a and b, low half in a, high in b
+                    static void multiply(std::uint64_t & a, std::uint64_t & b) {
+#ifdef __SIZEOF_INT128__
+                        unsigned __int128 r = a;
+                        r *= b;
+                        a = static_cast<std::uint64_t>(r);
+                        b = static_cast<std::uint64_t>(r >> 64);
+#else
+                        std::uint64_t ha = a >> 32, la = a & 0xffffffffull;
+                        std::uint64_t hb = b >> 32, lb = b & 0xffffffffull;
+                        std::uint64_t rh = ha * hb, rm0 = ha * lb,
+                                      rm1 = hb * la, rl = la * lb;
+                        std::uint64_t t = rl + (rm0 << 32);
+                        std::uint64_t c = t < rl;
+                        a = t + (rm1 << 32);
+                        c += a < t;
+                        b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+                    }
+
+                    // the 128 bit product of a and b, with its halves xored
+                    static std::uint64_t mix(std::uint64_t a, std::uint64_t b) {
+                        multiply(a, b);
+                        return a ^ b;
+                    }
+
+                    // one multiply is not enough for a single word, a flip
+                    // of its lowest bit always flips the lowest output bit
+                    HashCodeBuilder & addWord(std::uint64_t value) {
+                        std::uint64_t a = hash ^ P0, b = value ^ P1;
+                        multiply(a, b);
+                        hash = static_cast<std::size_t>(mix(a ^ P0, b ^ P1));
+                        return *this;
+                    }
+
+                    // hashes the bytes themselves, 32 at a time
+                    HashCodeBuilder & addBytes(const void * data,
+                                               std::size_t size);
+
+                    // hashes the values in [first, last) by content, long
+                    // ranges with the widest vector kernel the cpu supports,
+                    // see rangeKernel()
+                    //
+                    // floating point values go through add() one by one, as
+                    // their bytes differ for equal values such as 0.0 and
+                    // -0.0, any other type must not have padding bits
+                    template <typename V>
+                    HashCodeBuilder & addRange(const V * first,
+                                               const V * last) {
+                        if constexpr (std::is_floating_point<V>::value) {
+                            for (; first != last; ++first) {
+                                add(*first);
+                            }
+                            return *this;
+                        } else {
+                            static_assert(
+                                std::has_unique_object_representations_v<V>,
+                                "addRange hashes values by their bytes, V "
+                                "must not have padding");
+                            return addRangeBytes(first,
+                                                 (last - first) * sizeof(V));
+                        }
+                    }
+
+                    // addRange over the data() and size() of a contiguous
+                    // container, such as a std::vector, std::array or
+                    // std::string
+                    template <typename C,
+                              typename = decltype(std::declval<const C &>()
+                                                      .data()),
+                              typename = decltype(std::declval<const C &>()
+                                                      .size())>
+                    HashCodeBuilder & addRange(const C & container) {
+                        return addRange(container.data(),
+                                        container.data() + container.size());
+                    }
+
+                    HashCodeBuilder & addRangeBytes(const void * data,
+                                                    std::size_t size);
+
+                    // the name of the kernel used by addRange for long ranges,
+                    // "avx2", "sse2" or "scalar", all give the same hash
+                    static const char * rangeKernel();
+
+                    // makes addRange use the named kernel from now on, false
+                    // if the cpu does not support it, for tests and
+                    // benchmarks comparing the kernels
+                    static bool useRangeKernel(const char * name);
+
+                    template <typename U,
+                              typename std::enable_if<
+                                  std::is_base_of<Obj_Base, U>::value,
+                                  bool>::type = true>
+                    HashCodeBuilder & add(const U & obj) {
+                        return addWord(obj.hashCode());
+                    }
+
+                    template <typename U,
                               typename std::enable_if<
                                   !std::is_base_of<Obj_Base, U>::value,
                                   bool>::type = true>
                     HashCodeBuilder & add(const U & value) {
-                        hash =
-                            31 * hash
-                            + std::hash<typename std::remove_const<U>::type>()(
-                                value);
-                        return *this;
+                        using V = typename std::remove_const<U>::type;
+                        if constexpr (std::is_integral<V>::value
+                                      || std::is_enum<V>::value) {
+                            return addWord(static_cast<std::uint64_t>(value));
+                        } else if constexpr (std::is_pointer<V>::value) {
+                            return addWord(
+                                reinterpret_cast<std::uintptr_t>(value));
+                        } else if constexpr (std::is_convertible<
+                                                 const V &,
+                                                 std::string_view>::value) {
+                            std::string_view view = value;
+                            return addBytes(view.data(), view.size());
+                        } else {
+                            return addWord(std::hash<V>()(value));
+                        }
                     }
 
                     template <typename T>
@@ -324,6 +1449,121 @@ namespace LibObj {
             };
     };
 
+    // out[i] = objs[i]->hashCode() for every i below count, prefetching the
+    // objects ahead of the virtual calls
+    void hashMany(const Obj_Base * const * objs, std::size_t count,
+                  std::size_t * out);
+
+    // every class set up via one of the LIBOBJ_BASE macros, each registers
+    // itself during static initialisation
+    //
+    // lookups are lock free probes of open addressed tables keyed by type id
+    // and by name, so objects can be created from an id or name read off the
+    // wire in constant time
+    struct Obj_Registry {
+            template <typename T>
+            static bool add() {
+                static const bool added = [] {
+                    using P = Obj_ParentOf<T>;
+                    if constexpr (!std::is_same<P, Obj_Base>::value) {
+                        // parents are registered first, so a class never
+                        // has registered subclasses when it is numbered
+                        add<P>();
+                    }
+                    Obj_Registry_Entry & entry = Obj_RegistryEntryOf<T>;
+                    entry.type = &Obj_TypeDescriptorOf<T>;
+#ifdef RTTI_ENABLED
+                    entry.demangledName =
+                        Obj_Base::Obj_Base_ID::name(typeid(T));
+#else
+                    entry.demangledName = entry.type->name;
+#endif
+                    add(entry);
+                    return true;
+                }();
+                return added;
+            }
+
+            // entry must live for as long as the process
+            //
+            // never throws, as it runs during static initialisation, a
+            // different class registered under an id that is taken, such as
+            // a class of the same name in an anonymous namespace of another
+            // translation unit, is still numbered for is() and obj_cast(),
+            // but looking up the id or its name throws from then on
+            static void add(Obj_Registry_Entry & entry);
+
+            // nullptr if no class is registered under id or name, both the
+            // compile time name and the demangled name are accepted, throws
+            // if more than one class is registered under the id
+            static const Obj_Registry_Entry * findById(Obj_TypeId id);
+            static const Obj_Registry_Entry * findByName(std::string_view name);
+
+            // a new default constructed object of the registered class, to
+            // be deleted by the caller, nullptr if no class is registered or
+            // the class is abstract
+            static Obj_Base * createById(Obj_TypeId id);
+            static Obj_Base * createByName(std::string_view name);
+
+            static std::size_t size();
+    };
+
+    // converters between pairs of LibObj classes, looked up in a table with
+    // a row and a column for every class that takes part in a conversion,
+    // so finding the converter for an object of one class into an object
+    // of another takes two loads from the type descriptors and one from the
+    // table, however many conversions are registered
+    //
+    // Obj::from() converts through this table when there is a converter from
+    // the class of other to the class of this, classes overriding from() can
+    // call convert() themselves
+    //
+    // converters are registered for exact classes, a converter from From is
+    // not used for subclasses of From
+    struct Obj_Conversions {
+            using Thunk = void (*)(void (*convert)(), const Obj_Base & to,
+                                   const Obj_Base & from);
+
+            struct Conversion {
+                    const Obj_TypeDescriptor * from;
+                    const Obj_TypeDescriptor * to;
+            };
+
+            // registers convert as the converter from From to To, replacing
+            // any converter registered before
+            template <typename From, typename To>
+            static void add(void (*convert)(const To & to, const From & from)) {
+                static_assert(std::is_same<Obj_SelfOf<From>, From>::value
+                                  && std::is_same<Obj_SelfOf<To>, To>::value,
+                              "template arguments From and To must be set up "
+                              "via one of the LIBOBJ_BASE macros");
+                Obj_Registry::add<From>();
+                Obj_Registry::add<To>();
+                add(Obj_TypeDescriptorOf<From>, Obj_TypeDescriptorOf<To>,
+                    &call<From, To>, reinterpret_cast<void (*)()>(convert));
+            }
+
+            static void add(const Obj_TypeDescriptor & from,
+                            const Obj_TypeDescriptor & to, Thunk thunk,
+                            void (*convert)());
+
+            // converts from into to, false if no converter from the class of
+            // from to the class of to is registered
+            static bool convert(const Obj_Base & to, const Obj_Base & from);
+
+            // every registered pair of classes
+            static std::vector<Conversion> list();
+
+        private:
+            template <typename From, typename To>
+            static void call(void (*convert)(), const Obj_Base & to,
+                             const Obj_Base & from) {
+                reinterpret_cast<void (*)(const To &, const From &)>(convert)(
+                    static_cast<const To &>(to),
+                    static_cast<const From &>(from));
+            }
+    };
+
     template <class F>
     struct Obj_Base_ext_fncall : private F {
             Obj_Base_ext_fncall(F v) : F(v) {}
@@ -363,9 +1603,1019 @@ namespace LibObj {
         return obj->toStream(os);
     }
 
+#ifdef LIBOBJ_INTRUSIVE_REFCOUNT
+    // a reference counting handle that is a single pointer wide
+    //
+    // the count is stored inside the object itself, so an ObjRef can be made
+    // from any object allocated with `new` (including the result of clone()),
+    // and the object is deleted when the last ObjRef to it goes away
+    //
+    // objects owned by a std::shared_ptr or an Obj_Arena must not be handed
+    // to an ObjRef, and all handles to one object must share a Policy
+    template <typename T, typename Policy>
+    struct ObjRef : private Policy::Owner {
+            static_assert(std::is_base_of<Obj_Base, T>::value,
+                          "template argument T must derive from Obj_Base ( "
+                          "T : public Obj )");
+
+            ObjRef() = default;
+            ObjRef(std::nullptr_t) {}
+            explicit ObjRef(T * ptr) : ptr(ptr) {
+                retain();
+            }
+            ObjRef(const ObjRef & other) :
+                Policy::Owner(other), ptr(other.ptr) {
+                retain();
+            }
+            ObjRef(ObjRef && other) noexcept :
+                Policy::Owner(other), ptr(other.ptr) {
+                other.ptr = nullptr;
+            }
+            template <typename U,
+                      typename std::enable_if<
+                          std::is_convertible<U *, T *>::value, bool>::type =
+                          true>
+            ObjRef(const ObjRef<U, Policy> & other) :
+                Policy::Owner(other), ptr(other.ptr) {
+                retain();
+            }
+            template <typename U,
+                      typename std::enable_if<
+                          std::is_convertible<U *, T *>::value, bool>::type =
+                          true>
+            ObjRef(ObjRef<U, Policy> && other) noexcept :
+                Policy::Owner(other), ptr(other.ptr) {
+                other.ptr = nullptr;
+            }
+            ObjRef & operator=(ObjRef other) noexcept {
+                swap(other);
+                return *this;
+            }
+            ~ObjRef() {
+                release();
+            }
+
+            T * get() const {
+                return ptr;
+            }
+            T & operator*() const {
+                return *ptr;
+            }
+            T * operator->() const {
+                return ptr;
+            }
+            explicit operator bool() const {
+                return ptr != nullptr;
+            }
+
+            std::size_t useCount() const {
+                return ptr == nullptr
+                           ? 0
+                           : counter().load(std::memory_order_relaxed);
+            }
+
+            void reset() {
+                release();
+                ptr = nullptr;
+            }
+
+            void swap(ObjRef & other) noexcept {
+                std::swap(static_cast<typename Policy::Owner &>(*this),
+                          static_cast<typename Policy::Owner &>(other));
+                std::swap(ptr, other.ptr);
+            }
+
+        private:
+            template <typename U, typename P>
+            friend struct ObjRef;
+
+            T * ptr = nullptr;
+
+            std::atomic<std::size_t> & counter() const {
+                return static_cast<const Obj_Base *>(ptr)->objRefCount;
+            }
+
+            void retain() {
+                if (ptr != nullptr) {
+                    this->check();
+                    Policy::retain(counter());
+                }
+            }
+
+            void release() {
+                if (ptr != nullptr) {
+                    this->check();
+                    if (Policy::release(counter())) {
+                        delete ptr;
+                    }
+                }
+            }
+    };
+
+    template <typename T, typename U, typename P>
+    bool operator==(const ObjRef<T, P> & a, const ObjRef<U, P> & b) {
+        return a.get() == b.get();
+    }
+
+    template <typename T, typename U, typename P>
+    bool operator!=(const ObjRef<T, P> & a, const ObjRef<U, P> & b) {
+        return a.get() != b.get();
+    }
+
+    template <typename T, typename P>
+    bool operator==(const ObjRef<T, P> & a, std::nullptr_t) {
+        return a.get() == nullptr;
+    }
+
+    template <typename T, typename P>
+    bool operator!=(const ObjRef<T, P> & a, std::nullptr_t) {
+        return a.get() != nullptr;
+    }
+
+    template <typename T, typename P>
+    std::ostream & operator<<(std::ostream & os, const ObjRef<T, P> & obj) {
+        return obj->toStream(os);
+    }
+#endif
+
+    // allocates extra bytes behind whatever std::allocate_shared asks for,
+    // so the objects of an Obj_Batch live in the same block as its control
+    // block
+    //
+    // nothing is assumed about how often std::allocate_shared allocates, any
+    // block that holds the Obj_Batch_Storage has the extra bytes behind it
+    template <typename U>
+    struct Obj_Batch_Allocator {
+            using value_type = U;
+
+            std::size_t extra;
+
+            explicit Obj_Batch_Allocator(std::size_t extra) : extra(extra) {}
+
+            template <typename V>
+            Obj_Batch_Allocator(const Obj_Batch_Allocator<V> & other) :
+                extra(other.extra) {}
+
+            U * allocate(std::size_t n) {
+                if (n > (SIZE_MAX - extra) / sizeof(U)) {
+                    throw std::bad_array_new_length();
+                }
+                return static_cast<U *>(::operator new(
+                    n * sizeof(U) + extra, std::align_val_t(alignof(U))));
+            }
+
+            void deallocate(U * p, std::size_t) {
+                ::operator delete(p, std::align_val_t(alignof(U)));
+            }
+
+            template <typename V>
+            bool operator==(const Obj_Batch_Allocator<V> & other) const {
+                return extra == other.extra;
+            }
+
+            template <typename V>
+            bool operator!=(const Obj_Batch_Allocator<V> & other) const {
+                return !(*this == other);
+            }
+    };
+
+    // the objects of an Obj_Batch, destroyed with the control block
+    template <typename T>
+    struct Obj_Batch_Storage {
+            T * items = nullptr;
+            std::size_t constructed = 0;
+
+            Obj_Batch_Storage() = default;
+            Obj_Batch_Storage(const Obj_Batch_Storage & other) = delete;
+            Obj_Batch_Storage & operator=(const Obj_Batch_Storage & other) =
+                delete;
+            ~Obj_Batch_Storage() {
+                while (constructed > 0) {
+                    items[--constructed].~T();
+                }
+            }
+    };
+
+    // n objects of type T stored back to back in one allocation, created
+    // by Obj_Base::CreateN
+    //
+    // the objects stay alive for as long as the batch, or any handle
+    // obtained from it, does
+    template <typename T>
+    struct Obj_Batch {
+            static_assert(std::is_base_of<Obj_Base, T>::value,
+                          "template argument T must derive from Obj_Base ( "
+                          "T : public Obj )");
+
+            Obj_Batch() = default;
+
+            template <class... Args>
+            Obj_Batch(std::size_t n, const Args &... args) {
+                if (n > (SIZE_MAX - alignof(T)) / sizeof(T)) {
+                    throw std::bad_array_new_length();
+                }
+                auto storage = std::allocate_shared<Obj_Batch_Storage<T>>(
+                    Obj_Batch_Allocator<Obj_Batch_Storage<T>>(
+                        n * sizeof(T) + alignof(T) - 1));
+                // the objects start right behind the storage, within the
+                // extra bytes of the block holding it
+                std::uintptr_t end =
+                    reinterpret_cast<std::uintptr_t>(storage.get())
+                    + sizeof(Obj_Batch_Storage<T>);
+                end = (end + alignof(T) - 1)
+                      & ~(std::uintptr_t) (alignof(T) - 1);
+                storage->items = reinterpret_cast<T *>(end);
+                while (storage->constructed < n) {
+                    ::new (storage->items + storage->constructed) T(args...);
+                    storage->constructed++;
+                }
+                items = storage->items;
+                count = n;
+                owner = std::move(storage);
+            }
+
+            std::size_t size() const {
+                return count;
+            }
+            bool empty() const {
+                return count == 0;
+            }
+
+            T * begin() const {
+                return items;
+            }
+            T * end() const {
+                return items + count;
+            }
+
+            T & operator[](std::size_t i) const {
+                return items[i];
+            }
+
+            // a handle to the i'th object that shares ownership of the batch
+            std::shared_ptr<T> handle(std::size_t i) const {
+                return std::shared_ptr<T>(owner, items + i);
+            }
+
+        private:
+            std::shared_ptr<void> owner;
+            T * items = nullptr;
+            std::size_t count = 0;
+    };
+
+    // hands out objects of type T and takes them back for reuse
+    //
+    // an object given back is reinitialised via reset() and kept for the
+    // next acquire(), up to capacity objects are kept, so in steady state
+    // neither allocation nor construction happens
+    //
+    // a pool is not thread safe and must outlive the handles it hands out
+    template <typename T>
+    struct ObjPool {
+            static_assert(std::is_base_of<Obj_Base, T>::value,
+                          "template argument T must derive from Obj_Base ( "
+                          "T : public Obj )");
+
+            struct Releaser {
+                    ObjPool * pool;
+
+                    void operator()(T * obj) const {
+                        pool->release(obj);
+                    }
+            };
+
+            using Handle = std::unique_ptr<T, Releaser>;
+
+            explicit ObjPool(std::size_t capacity = 64) : capacity(capacity) {}
+            ObjPool(const ObjPool & other) = delete;
+            ObjPool(ObjPool && other) = delete;
+            ObjPool & operator=(const ObjPool & other) = delete;
+            ObjPool & operator=(ObjPool && other) = delete;
+            ~ObjPool() {
+                for (T * obj : pool) {
+                    delete obj;
+                }
+            }
+
+            Handle acquire() {
+                T * obj;
+                if (pool.empty()) {
+                    obj = new T();
+                } else {
+                    obj = pool.back();
+                    pool.pop_back();
+                }
+                return Handle(obj, Releaser {this});
+            }
+
+            // constructs objects up front until n are available
+            void reserve(std::size_t n) {
+                pool.reserve(n > capacity ? n : capacity);
+                while (pool.size() < n) {
+                    pool.push_back(new T());
+                }
+            }
+
+            std::size_t available() const {
+                return pool.size();
+            }
+
+        private:
+            std::vector<T *> pool;
+            std::size_t capacity;
+
+            void release(T * obj) {
+                if (pool.size() < capacity) {
+                    obj->reset();
+                    obj->markDirty();
+                    pool.push_back(obj);
+                } else {
+                    delete obj;
+                }
+            }
+    };
+
+    // hands out one canonical object per set of structurally equal objects,
+    // found via hashCode() and operator==, so duplicates share storage and
+    // canonical objects can be compared by pointer
+    //
+    // the table only holds weak references, a canonical object is destroyed
+    // once the last handle to it is dropped, and its entry is swept on a
+    // later insert into the same shard
+    //
+    // the table is split into Shards, each behind its own lock, so threads
+    // interning different objects rarely contend
+    //
+    // canonical objects are shared and must not be changed, via from() or
+    // otherwise, while they are interned
+    template <typename T, std::size_t Shards = 16>
+    struct ObjInterner {
+            static_assert(std::is_base_of<Obj_Base, T>::value,
+                          "template argument T must derive from Obj_Base ( "
+                          "T : public Obj )");
+            static_assert(Shards > 0, "an interner needs at least one shard");
+
+            ObjInterner() = default;
+            ObjInterner(const ObjInterner & other) = delete;
+            ObjInterner(ObjInterner && other) = delete;
+            ObjInterner & operator=(const ObjInterner & other) = delete;
+            ObjInterner & operator=(ObjInterner && other) = delete;
+
+            // the canonical object equal to value, a clone of value becomes
+            // canonical if there is none
+            std::shared_ptr<const T> intern(const T & value) {
+                return intern(value, nullptr);
+            }
+
+            // the canonical object equal to *value, value itself becomes
+            // canonical if there is none, so nothing is cloned, nullptr for
+            // nullptr
+            std::shared_ptr<const T> intern(std::shared_ptr<const T> value) {
+                if (value == nullptr) {
+                    return nullptr;
+                }
+                const T & ref = *value;
+                return intern(ref, std::move(value));
+            }
+
+            // the canonical object equal to value, nullptr if there is none
+            std::shared_ptr<const T> find(const T & value) const {
+                std::size_t hash = value.hashCode();
+                Shard & shard = shardOf(hash);
+                std::lock_guard<std::mutex> lock(shard.lock);
+                auto range = shard.entries.equal_range(hash);
+                for (auto it = range.first; it != range.second; ++it) {
+                    std::shared_ptr<const T> canonical = it->second.lock();
+                    if (canonical != nullptr && *canonical == value) {
+                        return canonical;
+                    }
+                }
+                return nullptr;
+            }
+
+            // drops the entries of destroyed canonical objects, returns how
+            // many were dropped
+            std::size_t purge() {
+                std::size_t purged = 0;
+                for (Shard & shard : shards) {
+                    std::lock_guard<std::mutex> lock(shard.lock);
+                    purged += shard.sweep();
+                }
+                return purged;
+            }
+
+            // the number of canonical objects still alive
+            std::size_t size() const {
+                std::size_t live = 0;
+                for (Shard & shard : shards) {
+                    std::lock_guard<std::mutex> lock(shard.lock);
+                    for (auto & entry : shard.entries) {
+                        live += !entry.second.expired();
+                    }
+                }
+                return live;
+            }
+
+        private:
+            struct alignas(64) Shard {
+                    mutable std::mutex lock;
+                    std::unordered_multimap<std::size_t, std::weak_ptr<const T>>
+                        entries;
+                    // the next insert at this many entries sweeps the shard,
+                    // which keeps dead entries below the number of live ones
+                    std::size_t sweepAt = 64;
+
+                    std::size_t sweep() {
+                        std::size_t before = entries.size();
+                        for (auto it = entries.begin(); it != entries.end();) {
+                            if (it->second.expired()) {
+                                it = entries.erase(it);
+                            } else {
+                                ++it;
+                            }
+                        }
+                        std::size_t after = entries.size();
+                        sweepAt = after * 2 > 64 ? after * 2 : 64;
+                        return before - after;
+                    }
+            };
+
+            mutable Shard shards[Shards];
+
+            Shard & shardOf(std::size_t hash) const {
+                // mixed first, the low bits of hashCode() also pick the bucket
+                // within the shard
+                std::size_t mixed = Obj_Base::HashCodeBuilder().add(hash).hash;
+                return shards[mixed % Shards];
+            }
+
+            std::shared_ptr<const T> intern(const T & value,
+                                            std::shared_ptr<const T> owner) {
+                std::size_t hash = value.hashCode();
+                Shard & shard = shardOf(hash);
+                std::lock_guard<std::mutex> lock(shard.lock);
+                auto range = shard.entries.equal_range(hash);
+                for (auto it = range.first; it != range.second;) {
+                    std::shared_ptr<const T> canonical = it->second.lock();
+                    if (canonical == nullptr) {
+                        it = shard.entries.erase(it);
+                    } else if (*canonical == value) {
+                        return canonical;
+                    } else {
+                        ++it;
+                    }
+                }
+                if (owner == nullptr) {
+                    owner.reset(static_cast<const T *>(value.clone()));
+                }
+                if (shard.entries.size() >= shard.sweepAt) {
+                    shard.sweep();
+                }
+                shard.entries.emplace(hash, owner);
+                return owner;
+            }
+    };
+
+    // a polymorphic value that holds its own copy of an object
+    //
+    // objects of at most N bytes, with an alignment no stricter than
+    // std::max_align_t, are stored inline, larger ones on the heap
+    //
+    // copies go through clone_into() or clone(), moves construct a default
+    // object of the same type via baseClone_into() or baseClone() and then
+    // move into it via from(Obj_Base &&)
+    template <std::size_t N = 64>
+    struct ObjBox {
+            ObjBox() = default;
+            explicit ObjBox(const Obj_Base & obj) {
+                copyFrom(obj);
+            }
+            explicit ObjBox(Obj_Base && obj) {
+                moveFrom(std::move(obj));
+            }
+            ObjBox(const ObjBox & other) {
+                if (other.ptr != nullptr) {
+                    copyFrom(*other.ptr);
+                }
+            }
+            // moves are noexcept so containers of boxes move them when they
+            // grow, a from(Obj_Base &&) that throws while moving an inline
+            // object calls std::terminate
+            ObjBox(ObjBox && other) noexcept {
+                take(std::move(other));
+            }
+            ObjBox & operator=(const ObjBox & other) {
+                if (this != &other) {
+                    reset();
+                    if (other.ptr != nullptr) {
+                        copyFrom(*other.ptr);
+                    }
+                }
+                return *this;
+            }
+            ObjBox & operator=(ObjBox && other) noexcept {
+                if (this != &other) {
+                    reset();
+                    take(std::move(other));
+                }
+                return *this;
+            }
+            ~ObjBox() {
+                reset();
+            }
+
+            // constructs a T directly in the box
+            template <typename T, class... Args>
+            static ObjBox Make(Args &&... args) {
+                static_assert(std::is_base_of<Obj_Base, T>::value,
+                              "template argument T must derive from Obj_Base ( "
+                              "T : public Obj )");
+                ObjBox box;
+                if constexpr (fits(sizeof(T), alignof(T))) {
+                    box.ptr =
+                        ::new (box.storage) T(std::forward<Args>(args)...);
+                } else {
+                    box.ptr = new T(std::forward<Args>(args)...);
+                }
+                return box;
+            }
+
+            Obj_Base * get() const {
+                return ptr;
+            }
+            Obj_Base & operator*() const {
+                return *ptr;
+            }
+            Obj_Base * operator->() const {
+                return ptr;
+            }
+            explicit operator bool() const {
+                return ptr != nullptr;
+            }
+
+            bool isInline() const {
+                return ptr != nullptr && static_cast<void *>(ptr) == storage;
+            }
+
+            void reset() {
+                if (isInline()) {
+                    ptr->~Obj_Base();
+                } else {
+                    delete ptr;
+                }
+                ptr = nullptr;
+            }
+
+        private:
+            alignas(std::max_align_t) unsigned char storage[N];
+            Obj_Base * ptr = nullptr;
+
+            static constexpr bool fits(std::size_t size,
+                                       std::size_t alignment) {
+                return size <= N && alignment <= alignof(std::max_align_t);
+            }
+
+            static bool fits(const Obj_Base & obj) {
+                const Obj_TypeDescriptor & type = obj.getObjTypeDescriptor();
+                return fits(type.size, type.alignment);
+            }
+
+            void copyFrom(const Obj_Base & obj) {
+                if (fits(obj)) {
+                    ptr = obj.clone_into(storage, N);
+                } else {
+                    ptr = obj.clone();
+                }
+            }
+
+            void moveFrom(Obj_Base && obj) {
+                bool inlined = fits(obj);
+                Obj_Base * p =
+                    inlined ? obj.baseClone_into(storage, N) : obj.baseClone();
+#ifdef LIBOBJ_CLONE_TYPE_CHECK
+                if (typeid(obj) != typeid(*p)) {
+                    auto self = obj.getObjId();
+                    const std::type_info & clone = typeid(*p);
+                    if (inlined) {
+                        p->~Obj_Base();
+                    } else {
+                        delete p;
+                    }
+                    Obj_Base::throwCloneTypeMismatch(self, clone);
+                }
+#endif
+                ptr = p;
+                p->from(std::move(obj));
+            }
+
+            void take(ObjBox && other) {
+                if (other.isInline()) {
+                    moveFrom(std::move(*other.ptr));
+                    other.reset();
+                } else {
+                    ptr = other.ptr;
+                    other.ptr = nullptr;
+                }
+            }
+    };
+
+    // a value holding an object of one of a closed set of LibObj classes
+    //
+    // the object is stored inline along with the index of its class in Ts,
+    // visit() switches on the index and calls f with the object as its
+    // concrete type, so hashCode() and << call the implementations of each
+    // class directly, where the compiler can inline them, instead of going
+    // through the vtable
+    //
+    // == compares the indexes first and only calls operator== of the object
+    // if they match
+    //
+    // an ObjVariant converts to Obj_Base &, and can be constructed from any
+    // Obj_Base that is one of Ts, which throws otherwise
+    //
+    // copies and moves follow ObjBox, copies construct a default object and
+    // pass it to clone_impl(), moves construct a default object and move
+    // into it via from(Obj_Base &&)
+    template <typename... Ts>
+    struct ObjVariant {
+            static_assert(sizeof...(Ts) > 0 && sizeof...(Ts) < 256,
+                          "ObjVariant holds between 1 and 255 classes");
+            static_assert((std::is_base_of<Obj_Base, Ts>::value && ...),
+                          "template arguments Ts must derive from Obj_Base ( "
+                          "T : public Obj )");
+            static_assert((!std::is_abstract<Ts>::value && ...),
+                          "template arguments Ts must not be abstract");
+
+            // holds a default constructed object of the first class
+            ObjVariant() {
+                ::new (storage) Alternative<0>();
+            }
+            explicit ObjVariant(const Obj_Base & obj) : tag(indexOf(obj)) {
+                copyFrom(obj);
+            }
+            explicit ObjVariant(Obj_Base && obj) : tag(indexOf(obj)) {
+                moveFrom(std::move(obj));
+            }
+            ObjVariant(const ObjVariant & other) : tag(other.tag) {
+                copyFrom(*other);
+            }
+            // noexcept like the moves of ObjBox
+            ObjVariant(ObjVariant && other) noexcept : tag(other.tag) {
+                moveFrom(std::move(*other));
+            }
+            // if copying throws, the variant is left holding a default
+            // constructed object of the first class
+            ObjVariant & operator=(const ObjVariant & other) {
+                if (this != &other) {
+                    replace(other.tag, [&] { copyFrom(*other); });
+                }
+                return *this;
+            }
+            ObjVariant & operator=(ObjVariant && other) noexcept {
+                if (this != &other) {
+                    replace(other.tag, [&] { moveFrom(std::move(*other)); });
+                }
+                return *this;
+            }
+            ~ObjVariant() {
+                destroy();
+            }
+
+            // constructs a T directly in the variant
+            template <typename T, class... Args>
+            static ObjVariant Make(Args &&... args) {
+                static_assert(indexOf<T>() < sizeof...(Ts),
+                              "template argument T must be one of Ts");
+                ObjVariant variant(Construct {});
+                variant.tag = static_cast<std::uint8_t>(indexOf<T>());
+                ::new (variant.storage) T(std::forward<Args>(args)...);
+                return variant;
+            }
+
+            // the index in Ts of the class of the object
+            std::size_t index() const {
+                return tag;
+            }
+
+            // the same as getObjTypeId() on the object, without a virtual
+            // call
+            Obj_TypeId getObjTypeId() const {
+                static constexpr Obj_TypeId ids[] = {Obj_TypeIdOf<Ts>...};
+                return ids[tag];
+            }
+
+            template <typename T>
+            bool holds() const {
+                return tag == indexOf<T>();
+            }
+
+            // nullptr if the object is not a T
+            template <typename T>
+            T * get() {
+                return holds<T>() ? reinterpret_cast<T *>(storage) : nullptr;
+            }
+            template <typename T>
+            const T * get() const {
+                return holds<T>() ? reinterpret_cast<const T *>(storage)
+                                  : nullptr;
+            }
+
+            Obj_Base & operator*() {
+                return visit([](Obj_Base & obj) -> Obj_Base & { return obj; });
+            }
+            const Obj_Base & operator*() const {
+                return visit([](const Obj_Base & obj) -> const Obj_Base & {
+                    return obj;
+                });
+            }
+            Obj_Base * operator->() {
+                return &**this;
+            }
+            const Obj_Base * operator->() const {
+                return &**this;
+            }
+            operator Obj_Base &() {
+                return **this;
+            }
+            operator const Obj_Base &() const {
+                return **this;
+            }
+
+            // calls f with the object as the class it is, all calls must
+            // return the same type
+            template <typename F>
+            decltype(auto) visit(F && f) {
+                return dispatch(tag, [&](auto type) -> decltype(auto) {
+                    using T = typename decltype(type)::type;
+                    return f(*reinterpret_cast<T *>(storage));
+                });
+            }
+            template <typename F>
+            decltype(auto) visit(F && f) const {
+                return dispatch(tag, [&](auto type) -> decltype(auto) {
+                    using T = typename decltype(type)::type;
+                    return f(*reinterpret_cast<const T *>(storage));
+                });
+            }
+
+            std::size_t hashCode() const {
+                return visit([](const auto & obj) {
+                    using T = std::decay_t<decltype(obj)>;
+                    return obj.T::hashCode();
+                });
+            }
+
+            bool operator==(const ObjVariant & other) const {
+                return tag == other.tag && **this == *other;
+            }
+            bool operator!=(const ObjVariant & other) const {
+                return !(*this == other);
+            }
+
+            friend std::ostream & operator<<(std::ostream & os,
+                                             const ObjVariant & variant) {
+                return variant.visit(
+                    [&](const auto & obj) -> std::ostream & {
+                        using T = std::decay_t<decltype(obj)>;
+                        return obj.T::toStream(os);
+                    });
+            }
+
+        private:
+            template <std::size_t I>
+            using Alternative =
+                typename std::tuple_element<I, std::tuple<Ts...>>::type;
+
+            struct Construct {};
+
+            alignas(Ts...) unsigned char storage[std::max({sizeof(Ts)...})];
+            std::uint8_t tag = 0;
+
+            explicit ObjVariant(Construct) {}
+
+            template <typename T>
+            static constexpr std::size_t indexOf() {
+                constexpr bool matches[] = {std::is_same<T, Ts>::value...};
+                for (std::size_t i = 0; i < sizeof...(Ts); i++) {
+                    if (matches[i]) {
+                        return i;
+                    }
+                }
+                return sizeof...(Ts);
+            }
+
+            static std::uint8_t indexOf(const Obj_Base & obj) {
+                static constexpr const Obj_TypeDescriptor * types[] = {
+                    &Obj_TypeDescriptorOf<Ts>...};
+                const Obj_TypeDescriptor & type = obj.getObjTypeDescriptor();
+                for (std::size_t i = 0; i < sizeof...(Ts); i++) {
+                    if (types[i]->sameClass(type)) {
+                        return static_cast<std::uint8_t>(i);
+                    }
+                }
+                Obj_Base::throwVariantTypeMismatch(obj.getObjId());
+            }
+
+            // calls f with the Obj_Type_Tag of the class at index, the
+            // chain of compares on the same value is turned into a jump
+            // table by the compiler
+            template <std::size_t I = 0, typename F>
+            static decltype(auto) dispatch(std::size_t index, F && f) {
+                if constexpr (I + 1 == sizeof...(Ts)) {
+                    return f(Obj_Type_Tag<Alternative<I>>());
+                } else {
+                    if (index == I) {
+                        return f(Obj_Type_Tag<Alternative<I>>());
+                    }
+                    return dispatch<I + 1>(index, std::forward<F>(f));
+                }
+            }
+
+            void destroy() {
+                dispatch(tag, [&](auto type) {
+                    using T = typename decltype(type)::type;
+                    reinterpret_cast<T *>(storage)->~T();
+                });
+            }
+
+            // the clone of obj, which is of the class at tag
+            void copyFrom(const Obj_Base & obj) {
+                dispatch(tag, [&](auto type) {
+                    using T = typename decltype(type)::type;
+                    T * p = ::new (storage) T();
+                    try {
+                        obj.clone_impl(p);
+                    } catch (...) {
+                        p->~T();
+                        throw;
+                    }
+                });
+            }
+
+            void moveFrom(Obj_Base && obj) {
+                dispatch(tag, [&](auto type) {
+                    using T = typename decltype(type)::type;
+                    T * p = ::new (storage) T();
+                    try {
+                        p->from(std::move(obj));
+                    } catch (...) {
+                        p->~T();
+                        throw;
+                    }
+                });
+            }
+
+            template <typename F>
+            void replace(std::uint8_t index, F && construct) {
+                destroy();
+                tag = index;
+                try {
+                    construct();
+                } catch (...) {
+                    tag = 0;
+                    ::new (storage) Alternative<0>();
+                    throw;
+                }
+            }
+    };
+
+    // an Obj holding a StaticObj by value, so it can be handed to anything
+    // that takes an Obj_Base, see StaticObj::toObj()
+    //
+    // every call is forwarded to the held value
+    template <typename T>
+    struct StaticObjAdaptor final : public Obj {
+            LIBOBJ_BASE(StaticObjAdaptor<T>)
+
+            T value;
+
+            StaticObjAdaptor() = default;
+            explicit StaticObjAdaptor(const T & value) {
+                this->value.from(value);
+            }
+            explicit StaticObjAdaptor(T && value) {
+                this->value.from(std::move(value));
+            }
+
+            LIBOBJ_OVERRIDE__FROM_COPY {
+                value.from(other.as<StaticObjAdaptor>().value);
+            }
+
+            LIBOBJ_OVERRIDE__FROM_MOVE {
+                auto & adaptor = static_cast<StaticObjAdaptor &>(other);
+                value.from(std::move(adaptor.value));
+            }
+
+            LIBOBJ_OVERRIDE__EQUALS {
+                return getObjTypeDescriptor().sameClass(
+                           other.getObjTypeDescriptor())
+                       && value == other.as<StaticObjAdaptor>().value;
+            }
+
+            LIBOBJ_OVERRIDE__STREAM {
+                return value.toStream(os);
+            }
+
+            LIBOBJ_OVERRIDE__HASHCODE {
+                return value.hashCode();
+            }
+    };
+
+    // the interface of Obj without virtual functions, for value types that
+    // should not carry a vptr
+    //
+    // Derived hides the defaults below with its own functions of the same
+    // name and signature, every call is resolved at compile time, and
+    // toObj() wraps a copy in a StaticObjAdaptor when an Obj_Base is needed
+    //
+    // ```cpp
+    // struct Point final : StaticObj<Point> {
+    //     mutable int x = 0;
+    //     void from(const Point & other) const { x = other.x; }
+    //     std::size_t hashCode() const { return x; }
+    // };
+    // ```
+    template <typename Derived>
+    struct StaticObj {
+            // checked here rather than in the class body, where Derived is
+            // still incomplete
+            constexpr StaticObj() noexcept {
+                static_assert(std::is_final<Derived>::value,
+                              "template argument Derived must be final, calls "
+                              "through StaticObj<Derived> are only resolved "
+                              "correctly for the most derived class");
+            }
+
+            // a new default constructed Derived that is passed to from(),
+            // to be deleted by the caller
+            Derived * clone() const {
+                Derived * p = new Derived();
+                p->from(self());
+                return p;
+            }
+
+            // does nothing by default
+            void from(const Derived &) const {}
+            void from(Derived &&) const {}
+
+            // hashes the address of the object by default, like Obj
+            std::size_t hashCode() const {
+                return Obj_Base::HashCodeBuilder().add(this).hash;
+            }
+
+            // compares hashCode() by default, like Obj_Base
+            bool operator==(const Derived & other) const {
+                return self().hashCode() == other.hashCode();
+            }
+            bool operator!=(const Derived & other) const {
+                return !(self() == other);
+            }
+
+            std::ostream & toStream(std::ostream & os) const {
+                std::string hash = Obj_Base::HashCodeBuilder().hashAsHex(this);
+                return os << getObjTypeName() << "@" << hash.substr(2);
+            }
+            std::string toString() const {
+                std::ostringstream os;
+                self().toStream(os);
+                return os.str();
+            }
+
+            static constexpr Obj_TypeId getObjTypeId() {
+                return Obj_TypeIdOf<Derived>;
+            }
+            static constexpr std::string_view getObjTypeName() {
+                return Obj_TypeName::of<Derived>();
+            }
+
+            // a copy of this as an Obj
+            std::shared_ptr<StaticObjAdaptor<Derived>> toObj() const & {
+                return Obj_Base::Create<StaticObjAdaptor<Derived>>(self());
+            }
+            std::shared_ptr<StaticObjAdaptor<Derived>> toObj() && {
+                return Obj_Base::Create<StaticObjAdaptor<Derived>>(
+                    static_cast<Derived &&>(*this));
+            }
+
+        private:
+            const Derived & self() const {
+                return static_cast<const Derived &>(*this);
+            }
+    };
+
+    template <typename Derived>
+    std::ostream & operator<<(std::ostream & os,
+                              const StaticObj<Derived> & obj) {
+        return static_cast<const Derived &>(obj).toStream(os);
+    }
+
     struct Obj_Example_Base : public Obj {
             virtual bool isConst() const = 0;
             virtual const void * getValue() const = 0;
+            // getValue() and isConst() in one call
+            virtual Obj_ErasedPointer getPointer() const noexcept {
+                return {getValue(), isConst()};
+            }
     };
 
     template <typename T>
@@ -403,6 +2653,9 @@ namespace LibObj {
             const void * getValue() const override {
                 return value;
             }
+            Obj_ErasedPointer getPointer() const noexcept override {
+                return {value, std::is_const<T>::value};
+            }
 
             LIBOBJ_OVERRIDE__FROM_COPY {
                 std::cout << "other: " << other << "\n";
@@ -476,6 +2729,16 @@ namespace std {
                 return obj.hashCode();
             }
     };
+
+#ifdef LIBOBJ_INTRUSIVE_REFCOUNT
+    // hashes the handle like std::hash<std::shared_ptr<T>> does
+    template <typename T, typename P>
+    struct hash<LibObj::ObjRef<T, P>> {
+            size_t operator()(const LibObj::ObjRef<T, P> & obj) const {
+                return hash<T *>()(obj.get());
+            }
+    };
+#endif
 } // namespace std
 
 #endif
\ No newline at end of file
@@ -1,5 +1,16 @@
 #include <libobj.h>
 
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <shared_mutex>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
 #if defined(__clang__)
     #include <cxxabi.h>
 #elif defined(__GNUC__)
@@ -9,6 +20,11 @@
     #error Unsupported compiler
 #endif
 
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+    #define LIBOBJ_HASH_X86
+    #include <immintrin.h>
+#endif
+
 namespace LibObj {
     const std::string demangle(const std::type_info & ti) {
 #ifdef RTTI_ENABLED
@@ -27,7 +43,7 @@ namespace LibObj {
         std::free(realname);
         return r;
 #elif defined(_MSC_VER)
-        std::string r = std::string(it.name());
+        std::string r = std::string(ti.name());
         return r;
 #else
         #error Unsupported compiler
@@ -37,11 +53,240 @@ namespace LibObj {
 #endif
     }
 
+    namespace {
+        constexpr std::size_t Obj_Slab_Classes =
+            Obj_Slab::MaxSize / Obj_Slab::Granularity;
+
+        // chunks are aligned to their size, so the chunk (and therefore the
+        // heap) a block belongs to is found by masking the block address
+        constexpr std::size_t Obj_Slab_ChunkSize = 64 * 1024;
+
+        struct Obj_Slab_Heap;
+
+        struct Obj_Slab_Chunk {
+                Obj_Slab_Heap * owner;
+                Obj_Slab_Chunk * next;
+        };
+
+        // blocks start after the chunk header
+        constexpr std::size_t Obj_Slab_ChunkHeader =
+            (sizeof(Obj_Slab_Chunk) + Obj_Slab::Granularity - 1)
+            / Obj_Slab::Granularity * Obj_Slab::Granularity;
+
+        // one per size class and thread, aligned to a cache line so frees
+        // from other threads do not contend with the owner's magazine
+        struct alignas(64) Obj_Slab_Bin {
+                // blocks freed by the owning thread, a singly linked list
+                void * magazine = nullptr;
+                char * cursor = nullptr;
+                char * end = nullptr;
+                // blocks freed by other threads, a lock free stack that the
+                // owning thread takes over as a whole once its magazine runs
+                // dry
+                std::atomic<void *> remote {nullptr};
+        };
+
+        // the slab state of one thread
+        //
+        // heaps are never freed, when a thread exits its heap is abandoned
+        // and adopted by the next thread that needs one, frees from other
+        // threads keep arriving in its remote stacks in the meantime
+        struct Obj_Slab_Heap {
+                Obj_Slab_Bin bins[Obj_Slab_Classes];
+                Obj_Slab_Chunk * chunks = nullptr;
+                Obj_Slab_Heap * nextAbandoned = nullptr;
+        };
+
+        std::mutex Obj_Slab_abandonedLock;
+        Obj_Slab_Heap * Obj_Slab_abandoned = nullptr;
+
+        thread_local Obj_Slab_Heap * Obj_Slab_threadHeap = nullptr;
+
+        struct Obj_Slab_HeapOwner {
+                ~Obj_Slab_HeapOwner() {
+                    Obj_Slab_Heap * heap = Obj_Slab_threadHeap;
+                    if (heap == nullptr) {
+                        return;
+                    }
+                    Obj_Slab_threadHeap = nullptr;
+                    std::lock_guard<std::mutex> guard(Obj_Slab_abandonedLock);
+                    heap->nextAbandoned = Obj_Slab_abandoned;
+                    Obj_Slab_abandoned = heap;
+                }
+        };
+
+        thread_local Obj_Slab_HeapOwner Obj_Slab_heapOwner;
+
+        Obj_Slab_Heap * slabThreadHeap() {
+            Obj_Slab_Heap * heap = Obj_Slab_threadHeap;
+            if (heap != nullptr) {
+                return heap;
+            }
+            {
+                std::lock_guard<std::mutex> guard(Obj_Slab_abandonedLock);
+                heap = Obj_Slab_abandoned;
+                if (heap != nullptr) {
+                    Obj_Slab_abandoned = heap->nextAbandoned;
+                    heap->nextAbandoned = nullptr;
+                }
+            }
+            if (heap == nullptr) {
+                heap = new Obj_Slab_Heap();
+            }
+            Obj_Slab_threadHeap = heap;
+            // odr-use the owner so its destructor runs when the thread exits
+            (void) &Obj_Slab_heapOwner;
+            return heap;
+        }
+
+        std::size_t slabClassOf(std::size_t size) {
+            return (size - 1) / Obj_Slab::Granularity;
+        }
+    } // namespace
+
+    void * Obj_Slab::allocate(std::size_t size) {
+        if (size == 0) {
+            size = 1;
+        }
+        if (size > MaxSize) {
+            return ::operator new(size);
+        }
+        std::size_t sizeClass = slabClassOf(size);
+        Obj_Slab_Heap * heap = slabThreadHeap();
+        Obj_Slab_Bin & bin = heap->bins[sizeClass];
+        if (bin.magazine == nullptr) {
+            bin.magazine =
+                bin.remote.exchange(nullptr, std::memory_order_acquire);
+        }
+        if (bin.magazine != nullptr) {
+            void * block = bin.magazine;
+            bin.magazine = *static_cast<void **>(block);
+            return block;
+        }
+        std::size_t blockSize = (sizeClass + 1) * Granularity;
+        if (bin.cursor == nullptr
+            || bin.end - bin.cursor < (std::ptrdiff_t) blockSize) {
+            Obj_Slab_Chunk * chunk = static_cast<Obj_Slab_Chunk *>(
+                ::operator new(Obj_Slab_ChunkSize,
+                               std::align_val_t(Obj_Slab_ChunkSize)));
+            chunk->owner = heap;
+            chunk->next = heap->chunks;
+            heap->chunks = chunk;
+            bin.cursor = reinterpret_cast<char *>(chunk) + Obj_Slab_ChunkHeader;
+            bin.end = reinterpret_cast<char *>(chunk) + Obj_Slab_ChunkSize;
+        }
+        void * block = bin.cursor;
+        bin.cursor += blockSize;
+        return block;
+    }
+
+    void Obj_Slab::deallocate(void * ptr, std::size_t size) noexcept {
+        if (ptr == nullptr) {
+            return;
+        }
+        if (size == 0) {
+            size = 1;
+        }
+        if (size > MaxSize) {
+            ::operator delete(ptr);
+            return;
+        }
+        Obj_Slab_Chunk * chunk = reinterpret_cast<Obj_Slab_Chunk *>(
+            reinterpret_cast<std::uintptr_t>(ptr)
+            & ~(std::uintptr_t) (Obj_Slab_ChunkSize - 1));
+        Obj_Slab_Bin & bin = chunk->owner->bins[slabClassOf(size)];
+        if (chunk->owner == Obj_Slab_threadHeap) {
+            *static_cast<void **>(ptr) = bin.magazine;
+            bin.magazine = ptr;
+            return;
+        }
+        // the owner only ever takes the whole stack, so a plain push cannot
+        // suffer from ABA
+        void * head = bin.remote.load(std::memory_order_relaxed);
+        do {
+            *static_cast<void **>(ptr) = head;
+        } while (!bin.remote.compare_exchange_weak(head, ptr,
+                                                    std::memory_order_release,
+                                                    std::memory_order_relaxed));
+    }
+
+    Obj_Arena::Obj_Arena(std::size_t chunkSize) : chunkSize(chunkSize) {}
+
+    Obj_Arena::~Obj_Arena() {
+        reset();
+        ::operator delete(chunks);
+    }
+
+    void * Obj_Arena::allocate(std::size_t size, std::size_t alignment) {
+        std::uintptr_t aligned =
+            (reinterpret_cast<std::uintptr_t>(cursor) + alignment - 1)
+            & ~(std::uintptr_t) (alignment - 1);
+        if (cursor == nullptr
+            || aligned + size > reinterpret_cast<std::uintptr_t>(end)) {
+            std::size_t needed = sizeof(Chunk) + size + alignment;
+            std::size_t bytes = needed > chunkSize ? needed : chunkSize;
+            Chunk * chunk = static_cast<Chunk *>(::operator new(bytes));
+            chunk->next = chunks;
+            chunk->size = bytes;
+            chunks = chunk;
+            cursor = reinterpret_cast<char *>(chunk + 1);
+            end = reinterpret_cast<char *>(chunk) + bytes;
+            aligned =
+                (reinterpret_cast<std::uintptr_t>(cursor) + alignment - 1)
+                & ~(std::uintptr_t) (alignment - 1);
+        }
+        cursor = reinterpret_cast<char *>(aligned + size);
+        return reinterpret_cast<void *>(aligned);
+    }
+
+    void Obj_Arena::reset() {
+        while (destructors != nullptr) {
+            Destructor * record = destructors;
+            destructors = record->next;
+            record->obj->~Obj_Base();
+        }
+        // keep the newest chunk around for the next round of allocations
+        if (chunks != nullptr) {
+            Chunk * chunk = chunks->next;
+            while (chunk != nullptr) {
+                Chunk * next = chunk->next;
+                ::operator delete(chunk);
+                chunk = next;
+            }
+            chunks->next = nullptr;
+            cursor = reinterpret_cast<char *>(chunks + 1);
+            end = reinterpret_cast<char *>(chunks) + chunks->size;
+        }
+    }
+
+    void Obj_Arena::destroyLast() {
+        if (destructors == nullptr) {
+            return;
+        }
+        Destructor * record = destructors;
+        destructors = record->next;
+        record->obj->~Obj_Base();
+    }
+
+#ifdef LIBOBJ_INTRUSIVE_REFCOUNT
+    void Obj_RefCount_Local::threadMismatch() {
+        std::cerr << "LibObj: a LocalObjRef was used on a thread other than "
+                     "the one that created it\n";
+        std::abort();
+    }
+#endif
+
     std::ostream & operator<<(std::ostream & os, const Obj_Base & obj) {
         return obj.toStream(os);
     }
 
     bool Obj_Base::operator==(const Obj_Base & other) const {
+        if (this == &other) {
+            return true;
+        }
+        if (!getObjTypeDescriptor().sameClass(other.getObjTypeDescriptor())) {
+            return false;
+        }
         return hashCode() == other.hashCode();
     }
 
@@ -49,19 +294,337 @@ namespace LibObj {
         return !(*this == other);
     }
 
+    void Obj_Base::throwPointerAssignMismatch(const Obj_Base_ID & self,
+                                              const Obj_Base_ID & other,
+                                              const char * func) {
+        throw std::runtime_error(std::string(LIB_OBJ_ERROR_STRING) + ", this: "
+                                 + std::string(self.name()) + ", other: "
+                                 + std::string(other.name())
+                                 + ", func: " + func);
+    }
+
+    void Obj_Base::throwVariantTypeMismatch(const Obj_Base_ID & obj) {
+        std::ostringstream o;
+        o << "class " << obj.name()
+          << " is not one of the classes the ObjVariant can hold";
+        throw std::runtime_error(o.str());
+    }
+
+#ifdef RTTI_ENABLED
+    void Obj_Base::throwCloneTypeMismatch(const Obj_Base_ID & self,
+                                          const std::type_info & clone) {
+        std::ostringstream o;
+        o << "class " << self.name()
+          << " attempted to clone itself, but the resulting allocation "
+             "type is class "
+          << Obj_Base_ID::name(clone)
+          << ", does it use one of the LIBOBJ_BASE macros?";
+        throw std::runtime_error(o.str());
+    }
+#endif
+
+    void Obj_Base::throwCloneStorageMismatch(const Obj_Base_ID & self,
+                                             std::size_t size,
+                                             std::size_t alignment,
+                                             const void * buf,
+                                             std::size_t cap) {
+        std::ostringstream o;
+        o << "class " << self.name() << " needs " << size
+          << " bytes aligned to " << alignment
+          << " to be cloned into, but was given " << cap << " bytes at "
+          << buf;
+        throw std::runtime_error(o.str());
+    }
+
+    static std::uint64_t read8(const unsigned char * p) {
+        std::uint64_t v;
+        std::memcpy(&v, p, 8);
+        return v;
+    }
+
+    static std::uint64_t read4(const unsigned char * p) {
+        std::uint32_t v;
+        std::memcpy(&v, p, 4);
+        return v;
+    }
+
+    // the wyhash bulk loop and tail
+    Obj_Base::HashCodeBuilder &
+    Obj_Base::HashCodeBuilder::addBytes(const void * data, std::size_t size) {
+        const unsigned char * p = static_cast<const unsigned char *>(data);
+        std::uint64_t seed = hash ^ P0;
+        std::uint64_t a, b;
+        if (size <= 16) {
+            if (size >= 4) {
+                std::size_t m = (size >> 3) << 2;
+                a = (read4(p) << 32) | read4(p + m);
+                b = (read4(p + size - 4) << 32) | read4(p + size - 4 - m);
+            } else if (size > 0) {
+                a = (std::uint64_t(p[0]) << 16)
+                    | (std::uint64_t(p[size >> 1]) << 8) | p[size - 1];
+                b = 0;
+            } else {
+                a = b = 0;
+            }
+        } else {
+            std::size_t i = size;
+            if (i > 32) {
+                std::uint64_t seed1 = seed;
+                do {
+                    seed = mix(read8(p) ^ P1, read8(p + 8) ^ seed);
+                    seed1 = mix(read8(p + 16) ^ P2, read8(p + 24) ^ seed1);
+                    p += 32;
+                    i -= 32;
+                } while (i > 32);
+                seed ^= seed1;
+            }
+            while (i > 16) {
+                seed = mix(read8(p) ^ P1, read8(p + 8) ^ seed);
+                p += 16;
+                i -= 16;
+            }
+            a = read8(p + i - 16);
+            b = read8(p + i - 8);
+        }
+        hash = static_cast<std::size_t>(
+            mix(P1 ^ size, mix(a ^ P1, b ^ seed)));
+        return *this;
+    }
+
+    namespace {
+        // addRange hashes long ranges in the style of xxh3, eight 64 bit
+        // lanes are accumulated over 64 byte stripes with 32 x 32 bit
+        // multiplies, which vector units do four or eight at a time, and
+        // scrambled every block of 16 stripes
+        constexpr std::size_t Obj_Hash_Stripe = 64;
+        constexpr std::size_t Obj_Hash_BlockStripes = 16;
+        constexpr std::size_t Obj_Hash_Block =
+            Obj_Hash_Stripe * Obj_Hash_BlockStripes;
+
+        // shorter ranges go through addBytes
+        constexpr std::size_t Obj_Hash_RangeMin = 256;
+
+        // stripe s of a block uses keys [s, s + 8), the last stripe of the
+        // range uses [23, 31), splitmix64 output
+        struct Obj_Hash_Keys {
+                std::uint64_t k[32];
+
+                constexpr Obj_Hash_Keys() : k {} {
+                    std::uint64_t x = 0;
+                    for (std::uint64_t & key : k) {
+                        x += 0x9e3779b97f4a7c15ull;
+                        std::uint64_t z = x;
+                        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+                        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+                        key = z ^ (z >> 31);
+                    }
+                }
+        };
+
+        constexpr Obj_Hash_Keys Obj_Hash_Key {};
+
+        using Obj_Hash_Kernel = void (*)(std::uint64_t * acc,
+                                         const unsigned char * p,
+                                         std::size_t stripes,
+                                         const std::uint64_t * keys);
+
+        void accumulateScalar(std::uint64_t * acc, const unsigned char * p,
+                              std::size_t stripes, const std::uint64_t * keys) {
+            for (std::size_t s = 0; s < stripes; s++) {
+                for (std::size_t j = 0; j < 8; j++) {
+                    std::uint64_t d = read8(p + s * Obj_Hash_Stripe + j * 8);
+                    std::uint64_t k = d ^ keys[s + j];
+                    acc[j ^ 1] += d;
+                    acc[j] += (k & 0xffffffffull) * (k >> 32);
+                }
+            }
+        }
+
+#ifdef LIBOBJ_HASH_X86
+        __attribute__((target("sse2"))) void
+        accumulateSse2(std::uint64_t * acc, const unsigned char * p,
+                       std::size_t stripes, const std::uint64_t * keys) {
+            __m128i a[4];
+            for (int i = 0; i < 4; i++) {
+                a[i] = _mm_loadu_si128(reinterpret_cast<__m128i *>(acc) + i);
+            }
+            for (std::size_t s = 0; s < stripes; s++) {
+                const __m128i * d = reinterpret_cast<const __m128i *>(
+                    p + s * Obj_Hash_Stripe);
+                const __m128i * key =
+                    reinterpret_cast<const __m128i *>(keys + s);
+                for (int i = 0; i < 4; i++) {
+                    __m128i v = _mm_loadu_si128(d + i);
+                    __m128i k = _mm_xor_si128(v, _mm_loadu_si128(key + i));
+                    __m128i product =
+                        _mm_mul_epu32(k, _mm_srli_epi64(k, 32));
+                    __m128i swapped =
+                        _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+                    a[i] = _mm_add_epi64(a[i], _mm_add_epi64(swapped, product));
+                }
+            }
+            for (int i = 0; i < 4; i++) {
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(acc) + i, a[i]);
+            }
+        }
+
+        __attribute__((target("avx2"))) void
+        accumulateAvx2(std::uint64_t * acc, const unsigned char * p,
+                       std::size_t stripes, const std::uint64_t * keys) {
+            __m256i a[2];
+            for (int i = 0; i < 2; i++) {
+                a[i] =
+                    _mm256_loadu_si256(reinterpret_cast<__m256i *>(acc) + i);
+            }
+            for (std::size_t s = 0; s < stripes; s++) {
+                const __m256i * d = reinterpret_cast<const __m256i *>(
+                    p + s * Obj_Hash_Stripe);
+                const __m256i * key =
+                    reinterpret_cast<const __m256i *>(keys + s);
+                for (int i = 0; i < 2; i++) {
+                    __m256i v = _mm256_loadu_si256(d + i);
+                    __m256i k =
+                        _mm256_xor_si256(v, _mm256_loadu_si256(key + i));
+                    __m256i product =
+                        _mm256_mul_epu32(k, _mm256_srli_epi64(k, 32));
+                    __m256i swapped =
+                        _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+                    a[i] = _mm256_add_epi64(
+                        a[i], _mm256_add_epi64(swapped, product));
+                }
+            }
+            for (int i = 0; i < 2; i++) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(acc) + i,
+                                    a[i]);
+            }
+        }
+#endif
+
+        struct Obj_Hash_KernelInfo {
+                const char * name;
+                Obj_Hash_Kernel kernel;
+                bool (*supported)();
+        };
+
+        // widest first
+        const Obj_Hash_KernelInfo Obj_Hash_Kernels[] = {
+#ifdef LIBOBJ_HASH_X86
+            {"avx2", accumulateAvx2,
+             [] {
+                 __builtin_cpu_init();
+                 return bool(__builtin_cpu_supports("avx2"));
+             }},
+            {"sse2", accumulateSse2,
+             [] {
+                 __builtin_cpu_init();
+                 return bool(__builtin_cpu_supports("sse2"));
+             }},
+#endif
+            {"scalar", accumulateScalar, [] { return true; }},
+        };
+
+        std::atomic<const Obj_Hash_KernelInfo *> & hashKernel() {
+            static std::atomic<const Obj_Hash_KernelInfo *> kernel {[] {
+                for (const Obj_Hash_KernelInfo & info : Obj_Hash_Kernels) {
+                    if (info.supported()) {
+                        return &info;
+                    }
+                }
+                return &Obj_Hash_Kernels[0];
+            }()};
+            return kernel;
+        }
+    } // namespace
+
+    Obj_Base::HashCodeBuilder &
+    Obj_Base::HashCodeBuilder::addRangeBytes(const void * data,
+                                             std::size_t size) {
+        if (size < Obj_Hash_RangeMin) {
+            return addBytes(data, size);
+        }
+        const unsigned char * p = static_cast<const unsigned char *>(data);
+        const std::uint64_t * keys = Obj_Hash_Key.k;
+        Obj_Hash_Kernel kernel =
+            hashKernel().load(std::memory_order_relaxed)->kernel;
+        std::uint64_t acc[8] = {P0, P1, P2, P3, P3, P2, P1, P0};
+
+        // the last stripe is hashed on its own, even when it is full
+        std::size_t stripes = (size - 1) / Obj_Hash_Stripe;
+        for (; stripes >= Obj_Hash_BlockStripes;
+             stripes -= Obj_Hash_BlockStripes) {
+            kernel(acc, p, Obj_Hash_BlockStripes, keys);
+            for (std::size_t j = 0; j < 8; j++) {
+                acc[j] ^= acc[j] >> 47;
+                acc[j] ^= keys[16 + j];
+                acc[j] *= 0x9e3779b1ull;
+            }
+            p += Obj_Hash_Block;
+        }
+        kernel(acc, p, stripes, keys);
+        kernel(acc, static_cast<const unsigned char *>(data) + size
+                        - Obj_Hash_Stripe,
+               1, keys + 23);
+
+        std::uint64_t h = size * P0;
+        for (std::size_t j = 0; j < 8; j += 2) {
+            h += mix(acc[j] ^ keys[j], acc[j + 1] ^ keys[j + 1]);
+        }
+        return addWord(h);
+    }
+
+    const char * Obj_Base::HashCodeBuilder::rangeKernel() {
+        return hashKernel().load(std::memory_order_relaxed)->name;
+    }
+
+    bool Obj_Base::HashCodeBuilder::useRangeKernel(const char * name) {
+        for (const Obj_Hash_KernelInfo & info : Obj_Hash_Kernels) {
+            if (std::strcmp(info.name, name) == 0) {
+                if (!info.supported()) {
+                    return false;
+                }
+                hashKernel().store(&info, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void hashMany(const Obj_Base * const * objs, std::size_t count,
+                  std::size_t * out) {
+        const std::size_t ahead = 8;
+        for (std::size_t i = 0; i < count; i++) {
+#if defined(__GNUC__)
+            if (i + ahead < count) {
+                __builtin_prefetch(objs[i + ahead]);
+            }
+#endif
+            out[i] = objs[i]->hashCode();
+        }
+    }
+
     std::string Obj_Base::HashCodeBuilder::hashAsHex() {
         std::ostringstream h;
         h << "0x" << std::setw(6) << std::hex << hash;
         return h.str();
     }
 
-    void Obj::from(const Obj_Base & other) const {}
-    void Obj::from(Obj_Base && other) const {}
+    void Obj::from(const Obj_Base & other) const {
+        if (Obj_Conversions::convert(*this, other)) {
+            markDirty();
+        }
+    }
+    void Obj::from(Obj_Base && other) const {
+        if (Obj_Conversions::convert(*this, other)) {
+            markDirty();
+        }
+    }
 
     std::size_t Obj::hashCode() const {
         return HashCodeBuilder().add(this).hash;
     }
 
+    void Obj_Base::reset() const {}
+
     std::ostream & Obj_Base::toStream(std::ostream & os) const {
         return os << getObjId().name() << "@"
                   << HashCodeBuilder().hashAsHex(this).substr(2);
@@ -73,28 +636,506 @@ namespace LibObj {
         return os.str();
     }
 
-    Obj_Base::Obj_Base_ID::Obj_Base_ID(const Obj_Base & base)
+    Obj_Base::Obj_Base_ID::Obj_Base_ID(const Obj_Base & base) :
+        id(base.getObjTypeId()),
+        type(base.getObjTypeDescriptor())
 #ifdef RTTI_ENABLED
-    : id(typeid(base))
+        , info(typeid(base))
 #endif
     {}
 
-    std::string Obj_Base::Obj_Base_ID::name() const {
 #ifdef RTTI_ENABLED
-        return demangle(id);
+    namespace {
+        // demangled type names, keyed by type_index, so the type_info copies
+        // of one type in several shared libraries share an entry, entries
+        // are never removed so views of them stay valid
+        struct Obj_Names {
+                std::shared_mutex lock;
+                std::unordered_map<std::type_index, std::string> names;
+        };
+
+        Obj_Names & internedNames() {
+            // never destroyed, names may be asked for during static
+            // destruction
+            static Obj_Names * names = new Obj_Names();
+            return *names;
+        }
+    } // namespace
+#endif
+
+#ifdef RTTI_ENABLED
+    std::string_view Obj_Base::Obj_Base_ID::name(const std::type_info & info) {
+        Obj_Names & interned = internedNames();
+        {
+            std::shared_lock<std::shared_mutex> guard(interned.lock);
+            auto found = interned.names.find(std::type_index(info));
+            if (found != interned.names.end()) {
+                return found->second;
+            }
+        }
+        std::string demangled = demangle(info);
+        std::unique_lock<std::shared_mutex> guard(interned.lock);
+        return interned.names.emplace(info, std::move(demangled))
+            .first->second;
+    }
+#endif
+
+    std::string_view Obj_Base::Obj_Base_ID::name() const {
+#ifdef RTTI_ENABLED
+        return name(info);
 #else
-        return "RTTI NOT AVAILABLE";
+        return type.name;
 #endif
     }
 
-    bool
-    Obj_Base::Obj_Base_ID::operator==(const Obj_Base::Obj_Base_ID & other) {
-        return id == other.id;
+    namespace {
+        // an open addressed, linearly probed table of registry entries
+        //
+        // keys are hashes already and are used as they are, readers probe
+        // without locking, writers insert under the registry lock, and a
+        // table that is grown is kept alive for readers still probing it
+        struct Obj_Registry_Index {
+                struct Slot {
+                        std::atomic<Obj_TypeId> key {0};
+                        std::atomic<const Obj_Registry_Entry *> entry {
+                            nullptr};
+                };
+
+                struct Table {
+                        std::size_t mask;
+                        std::unique_ptr<Slot[]> slots;
+                        std::unique_ptr<Table> previous;
+
+                        explicit Table(std::size_t capacity) :
+                            mask(capacity - 1), slots(new Slot[capacity]) {}
+                };
+
+                std::atomic<Table *> table {new Table(256)};
+                std::size_t count = 0;
+
+                const Obj_Registry_Entry * find(Obj_TypeId key) const {
+                    Table * t = table.load(std::memory_order_acquire);
+                    std::size_t i = key & t->mask;
+                    for (;; i = (i + 1) & t->mask) {
+                        const Obj_Registry_Entry * entry =
+                            t->slots[i].entry.load(std::memory_order_acquire);
+                        if (entry == nullptr) {
+                            return nullptr;
+                        }
+                        if (t->slots[i].key.load(std::memory_order_relaxed)
+                            == key) {
+                            return entry;
+                        }
+                    }
+                }
+
+                static void place(Table * t, Obj_TypeId key,
+                                  const Obj_Registry_Entry * entry) {
+                    std::size_t i = key & t->mask;
+                    while (t->slots[i].entry.load(std::memory_order_relaxed)
+                           != nullptr) {
+                        i = (i + 1) & t->mask;
+                    }
+                    t->slots[i].key.store(key, std::memory_order_relaxed);
+                    t->slots[i].entry.store(entry, std::memory_order_release);
+                }
+
+                // the caller holds the registry lock
+                void insert(Obj_TypeId key, const Obj_Registry_Entry * entry) {
+                    Table * t = table.load(std::memory_order_relaxed);
+                    if ((count + 1) * 2 > t->mask + 1) {
+                        Table * grown = new Table((t->mask + 1) * 2);
+                        for (std::size_t i = 0; i <= t->mask; i++) {
+                            const Obj_Registry_Entry * e =
+                                t->slots[i].entry.load(
+                                    std::memory_order_relaxed);
+                            if (e != nullptr) {
+                                place(grown,
+                                      t->slots[i].key.load(
+                                          std::memory_order_relaxed),
+                                      e);
+                            }
+                        }
+                        grown->previous.reset(t);
+                        table.store(grown, std::memory_order_release);
+                        t = grown;
+                    }
+                    place(t, key, entry);
+                    count++;
+                }
+        };
+
+        struct Obj_Registry_State {
+                std::mutex lock;
+                Obj_Registry_Index byId;
+                // demangled names that are spelled differently from the
+                // compile time name, keyed by their hash
+                Obj_Registry_Index byName;
+                // every registered entry, in registration order
+                std::vector<Obj_Registry_Entry *> entries;
+                // entries of classes registered again, by another shared
+                // library for example, paired with the entry that was
+                // registered first, they are numbered along with it
+                std::vector<std::pair<Obj_Registry_Entry *,
+                                      const Obj_Registry_Entry *>>
+                    copies;
+                // why each id that more than one class is registered under
+                // cannot be looked up
+                std::unordered_map<Obj_TypeId, std::string> conflicts;
+        };
+
+        Obj_Registry_State & registryState() {
+            // never destroyed, classes may be looked up during static
+            // destruction
+            static Obj_Registry_State * state = new Obj_Registry_State();
+            return *state;
+        }
+
+        // writes to first and last of entries, as the one writer of
+        // Obj_Registry_Entry::numbering, the registry lock is held for as
+        // long as one lives
+        struct Obj_Renumbering {
+                std::uint32_t version =
+                    Obj_Registry_Entry::numbering.load(
+                        std::memory_order_relaxed);
+
+                Obj_Renumbering() {
+                    Obj_Registry_Entry::numbering.store(
+                        version + 1, std::memory_order_relaxed);
+                    std::atomic_thread_fence(std::memory_order_release);
+                }
+
+                ~Obj_Renumbering() {
+                    Obj_Registry_Entry::numbering.store(
+                        version + 2, std::memory_order_release);
+                }
+        };
+
+        // gives the newly registered entry, which never has subclasses yet,
+        // the slot after the subtree of its parent in the preorder numbering
+        // and shifts everything that follows
+        //
+        // the caller holds the registry lock, Obj_Base::is() running
+        // concurrently with a registration retries until it is done
+        void number(Obj_Registry_State & state, Obj_Registry_Entry & added,
+                    const Obj_Registry_Entry * parent) {
+            constexpr auto relaxed = std::memory_order_relaxed;
+            Obj_Renumbering renumbering;
+            std::uint32_t slot = static_cast<std::uint32_t>(
+                state.entries.size());
+            if (parent != nullptr) {
+                std::uint32_t first = parent->first.load(relaxed);
+                std::uint32_t last = parent->last.load(relaxed);
+                slot = last + 1;
+                for (Obj_Registry_Entry * e : state.entries) {
+                    if (e == &added) {
+                        continue;
+                    }
+                    if (e->first.load(relaxed) > last) {
+                        e->first.fetch_add(1, relaxed);
+                        e->last.fetch_add(1, relaxed);
+                    } else if (e->first.load(relaxed) <= first
+                               && e->last.load(relaxed) >= last) {
+                        // the parent and its ancestors grow by one
+                        e->last.fetch_add(1, relaxed);
+                    }
+                }
+            }
+            added.first.store(slot, relaxed);
+            added.last.store(slot, relaxed);
+            for (auto & copy : state.copies) {
+                copy.first->first.store(copy.second->first.load(relaxed),
+                                        relaxed);
+                copy.first->last.store(copy.second->last.load(relaxed),
+                                       relaxed);
+            }
+        }
+    } // namespace
+
+    namespace {
+        // whether two entries of the same name can be the same class seen
+        // by two shared libraries, a class in an anonymous namespace is
+        // local to one translation unit and never registered twice
+        bool sameClass(const Obj_Registry_Entry & a,
+                       const Obj_Registry_Entry & b) {
+            const Obj_TypeDescriptor & x = *a.type;
+            const Obj_TypeDescriptor & y = *b.type;
+            return x.name == y.name && !x.is(Obj_TypeDescriptor::Anonymous)
+                   && x.size == y.size && x.alignment == y.alignment
+                   && x.flags == y.flags
+                   && (x.parent == nullptr) == (y.parent == nullptr)
+                   && (x.parent == nullptr || x.parent->id == y.parent->id);
+        }
+
+        [[noreturn]] void throwConflict(Obj_Registry_State & state,
+                                        Obj_TypeId id) {
+            std::lock_guard<std::mutex> guard(state.lock);
+            throw std::runtime_error(state.conflicts[id]);
+        }
+    } // namespace
+
+    void Obj_Registry::add(Obj_Registry_Entry & entry) {
+        Obj_Registry_State & state = registryState();
+        std::lock_guard<std::mutex> guard(state.lock);
+        const Obj_Registry_Entry * existing = state.byId.find(entry.type->id);
+        if (existing == &entry) {
+            return;
+        }
+        if (existing != nullptr && sameClass(*existing, entry)) {
+            // registered again, for example by another shared library
+            state.copies.emplace_back(&entry, existing);
+            Obj_Renumbering renumbering;
+            entry.first.store(existing->first.load());
+            entry.last.store(existing->last.load());
+            entry.conversionIndex.store(existing->conversionIndex.load());
+            return;
+        }
+        if (existing != nullptr) {
+            if (std::find(state.entries.begin(), state.entries.end(), &entry)
+                != state.entries.end()) {
+                return;
+            }
+            // throwing here would end the process during static
+            // initialisation, the class is numbered like any other and only
+            // lookups of its id fail
+            std::ostringstream o;
+            if (existing->type->name != entry.type->name) {
+                o << "class " << entry.type->name
+                  << " has the same type id as class " << existing->type->name;
+            } else {
+                o << "class " << entry.type->name
+                  << " is registered by two different classes of that name, "
+                     "classes in anonymous namespaces must have names "
+                     "unique across translation units to be looked up";
+            }
+            state.conflicts.emplace(entry.type->id, o.str());
+            existing->conflict.store(true, std::memory_order_release);
+            entry.conflict.store(true, std::memory_order_release);
+        }
+        // registered before this class, and possibly a copy or one of
+        // several classes sharing an id, so not looked up by id
+        const Obj_Registry_Entry * parent =
+            entry.type->parent != nullptr ? entry.type->parent->entry : nullptr;
+        state.entries.push_back(&entry);
+        number(state, entry, parent);
+        if (existing != nullptr) {
+            return;
+        }
+        state.byId.insert(entry.type->id, &entry);
+        if (entry.demangledName != entry.type->name) {
+            state.byName.insert(Obj_TypeName::hash(entry.demangledName),
+                                &entry);
+        }
+    }
+
+    std::atomic<std::uint32_t> Obj_Registry_Entry::numbering {0};
+
+    const Obj_Registry_Entry * Obj_Registry::findById(Obj_TypeId id) {
+        Obj_Registry_State & state = registryState();
+        const Obj_Registry_Entry * entry = state.byId.find(id);
+        if (entry != nullptr
+            && entry->conflict.load(std::memory_order_acquire)) {
+            throwConflict(state, id);
+        }
+        return entry;
+    }
+
+    const Obj_Registry_Entry * Obj_Registry::findByName(std::string_view name) {
+        Obj_Registry_State & state = registryState();
+        Obj_TypeId hash = Obj_TypeName::hash(name);
+        const Obj_Registry_Entry * entry = state.byId.find(hash);
+        if (entry != nullptr
+            && entry->conflict.load(std::memory_order_acquire)) {
+            throwConflict(state, hash);
+        }
+        if (entry != nullptr && entry->type->name == name) {
+            return entry;
+        }
+        entry = state.byName.find(hash);
+        if (entry != nullptr && entry->demangledName == name) {
+            if (entry->conflict.load(std::memory_order_acquire)) {
+                throwConflict(state, entry->type->id);
+            }
+            return entry;
+        }
+        return nullptr;
+    }
+
+    Obj_Base * Obj_Registry::createById(Obj_TypeId id) {
+        const Obj_Registry_Entry * entry = findById(id);
+        if (entry == nullptr || entry->type->factory == nullptr) {
+            return nullptr;
+        }
+        return entry->type->factory();
+    }
+
+    Obj_Base * Obj_Registry::createByName(std::string_view name) {
+        const Obj_Registry_Entry * entry = findByName(name);
+        if (entry == nullptr || entry->type->factory == nullptr) {
+            return nullptr;
+        }
+        return entry->type->factory();
+    }
+
+    std::size_t Obj_Registry::size() {
+        Obj_Registry_State & state = registryState();
+        std::lock_guard<std::mutex> guard(state.lock);
+        return state.entries.size();
+    }
+
+    namespace {
+        struct Obj_Converter {
+                Obj_Conversions::Thunk thunk;
+                void (*convert)();
+        };
+
+        // a square table, converters from the class with index i are in
+        // row i, converters to the class with index j in column j
+        struct Obj_Conversion_Table {
+                std::size_t stride;
+                std::unique_ptr<std::atomic<const Obj_Converter *>[]> cells;
+
+                explicit Obj_Conversion_Table(std::size_t stride) :
+                    stride(stride),
+                    cells(new std::atomic<const Obj_Converter *>[stride
+                                                                 * stride]) {
+                    for (std::size_t i = 0; i < stride * stride; i++) {
+                        cells[i].store(nullptr, std::memory_order_relaxed);
+                    }
+                }
+        };
+
+        struct Obj_Conversions_State {
+                std::mutex lock;
+                std::atomic<Obj_Conversion_Table *> table {
+                    new Obj_Conversion_Table(16)};
+                // the class of each row and column
+                std::vector<const Obj_TypeDescriptor *> classes;
+                // tables that were grown and converters that were replaced,
+                // kept for readers that may still be using them
+                std::vector<std::unique_ptr<Obj_Conversion_Table>> retired;
+                std::vector<std::unique_ptr<const Obj_Converter>> converters;
+        };
+
+        Obj_Conversions_State & conversionsState() {
+            // never destroyed, like the registry
+            static Obj_Conversions_State * state = new Obj_Conversions_State();
+            return *state;
+        }
+
+        // the entry that is numbered for type, the entry of type itself
+        // unless it is a copy of one registered by another shared library
+        const Obj_Registry_Entry * numberedEntry(
+            const Obj_TypeDescriptor & type) {
+            Obj_Registry_State & registry = registryState();
+            std::lock_guard<std::mutex> guard(registry.lock);
+            for (auto & copy : registry.copies) {
+                if (copy.first == type.entry) {
+                    return copy.second;
+                }
+            }
+            return type.entry;
+        }
+
+        // the index of the row and column of type, adding one if it has
+        // none, the caller holds the conversions lock
+        std::size_t conversionIndex(Obj_Conversions_State & state,
+                                    const Obj_TypeDescriptor & type) {
+            const Obj_Registry_Entry * entry = numberedEntry(type);
+            std::uint32_t index =
+                entry->conversionIndex.load(std::memory_order_relaxed);
+            if (index != 0) {
+                return index - 1;
+            }
+            Obj_Conversion_Table * table =
+                state.table.load(std::memory_order_relaxed);
+            std::size_t added = state.classes.size();
+            if (added == table->stride) {
+                Obj_Conversion_Table * grown =
+                    new Obj_Conversion_Table(table->stride * 2);
+                for (std::size_t i = 0; i < table->stride; i++) {
+                    for (std::size_t j = 0; j < table->stride; j++) {
+                        grown->cells[i * grown->stride + j].store(
+                            table->cells[i * table->stride + j].load(
+                                std::memory_order_relaxed),
+                            std::memory_order_relaxed);
+                    }
+                }
+                state.retired.emplace_back(table);
+                // published before the index, so a reader that sees the
+                // index sees a table that has room for it
+                state.table.store(grown, std::memory_order_release);
+            }
+            state.classes.push_back(entry->type);
+            index = static_cast<std::uint32_t>(added + 1);
+            entry->conversionIndex.store(index, std::memory_order_release);
+            // objects of a class registered again by another shared library
+            // point at their own entry
+            Obj_Registry_State & registry = registryState();
+            std::lock_guard<std::mutex> guard(registry.lock);
+            for (auto & copy : registry.copies) {
+                if (copy.second == entry) {
+                    copy.first->conversionIndex.store(
+                        index, std::memory_order_release);
+                }
+            }
+            return added;
+        }
+    } // namespace
+
+    void Obj_Conversions::add(const Obj_TypeDescriptor & from,
+                              const Obj_TypeDescriptor & to, Thunk thunk,
+                              void (*convert)()) {
+        Obj_Conversions_State & state = conversionsState();
+        std::lock_guard<std::mutex> guard(state.lock);
+        std::size_t row = conversionIndex(state, from);
+        std::size_t column = conversionIndex(state, to);
+        state.converters.emplace_back(new Obj_Converter {thunk, convert});
+        Obj_Conversion_Table * table =
+            state.table.load(std::memory_order_relaxed);
+        table->cells[row * table->stride + column].store(
+            state.converters.back().get(), std::memory_order_release);
+    }
+
+    bool Obj_Conversions::convert(const Obj_Base & to, const Obj_Base & from) {
+        std::uint32_t row =
+            from.getObjTypeDescriptor().entry->conversionIndex.load(
+                std::memory_order_acquire);
+        std::uint32_t column =
+            to.getObjTypeDescriptor().entry->conversionIndex.load(
+                std::memory_order_acquire);
+        if (row == 0 || column == 0) {
+            return false;
+        }
+        Obj_Conversion_Table * table =
+            conversionsState().table.load(std::memory_order_acquire);
+        const Obj_Converter * converter =
+            table->cells[(row - 1) * table->stride + (column - 1)].load(
+                std::memory_order_acquire);
+        if (converter == nullptr) {
+            return false;
+        }
+        converter->thunk(converter->convert, to, from);
+        return true;
     }
 
-    bool
-    Obj_Base::Obj_Base_ID::operator!=(const Obj_Base::Obj_Base_ID & other) {
-        return id != other.id;
+    std::vector<Obj_Conversions::Conversion> Obj_Conversions::list() {
+        Obj_Conversions_State & state = conversionsState();
+        std::lock_guard<std::mutex> guard(state.lock);
+        Obj_Conversion_Table * table =
+            state.table.load(std::memory_order_relaxed);
+        std::vector<Conversion> conversions;
+        for (std::size_t i = 0; i < state.classes.size(); i++) {
+            for (std::size_t j = 0; j < state.classes.size(); j++) {
+                if (table->cells[i * table->stride + j].load(
+                        std::memory_order_relaxed)
+                    != nullptr) {
+                    conversions.push_back({state.classes[i],
+                                           state.classes[j]});
+                }
+            }
+        }
+        return conversions;
     }
 
     Obj_Base::Obj_Base_ID Obj_Base::getObjId() const {
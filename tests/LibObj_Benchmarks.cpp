@@ -0,0 +1,236 @@
+#include <gtest/gtest.h>
+
+#include <libobj.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace LibObj;
+
+// copies every handle of a vector into another, then drops the copies, which
+// is one reference count increment and one decrement per handle and round
+template <typename Handle>
+double copyHandles(const std::vector<Handle> & handles, int rounds) {
+    std::vector<Handle> copies;
+    copies.reserve(handles.size());
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++) {
+        for (const Handle & handle : handles) {
+            copies.push_back(handle);
+        }
+        copies.clear();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count()
+           / ((double) handles.size() * rounds);
+}
+
+#ifdef LIBOBJ_INTRUSIVE_REFCOUNT
+TEST(libobj_benchmark, refcount_copy) {
+    const int objects = 1024;
+    const int rounds = 2000;
+
+    // libstdc++ only skips atomics for std::shared_ptr while the process has
+    // never started a thread, start one so all handles are measured as they
+    // would be in a threaded program
+    std::thread([] {}).join();
+
+    std::vector<std::shared_ptr<Obj>> shared;
+    std::vector<ObjRef<Obj>> atomic;
+    std::vector<LocalObjRef<Obj>> local;
+    for (int i = 0; i < objects; i++) {
+        shared.push_back(Obj::Create<Obj>());
+        atomic.push_back(Obj::CreateRef<Obj>());
+        local.push_back(Obj::CreateLocal<Obj>());
+    }
+
+    double sharedTime = copyHandles(shared, rounds);
+    double atomicTime = copyHandles(atomic, rounds);
+    double localTime = copyHandles(local, rounds);
+
+    std::cout << "[BENCH] std::shared_ptr<Obj> copy: " << sharedTime
+              << " ns\n";
+    std::cout << "[BENCH] ObjRef<Obj>          copy: " << atomicTime
+              << " ns\n";
+    std::cout << "[BENCH] LocalObjRef<Obj>     copy: " << localTime
+              << " ns\n";
+}
+#endif
+
+#ifdef RTTI_ENABLED
+struct Obj_Cast_Bench_A : public Obj {
+        LIBOBJ_BASE(Obj_Cast_Bench_A)
+};
+
+struct Obj_Cast_Bench_B : public Obj_Cast_Bench_A {
+        LIBOBJ_BASE(Obj_Cast_Bench_B)
+};
+
+struct Obj_Cast_Bench_C : public Obj_Cast_Bench_B {
+        LIBOBJ_BASE(Obj_Cast_Bench_C)
+};
+
+// casts every object with cast, returning the time per cast, found counts the
+// successful casts so the loop is not optimised away
+template <typename Cast>
+double castObjects(const std::vector<std::shared_ptr<Obj_Base>> & objects,
+                   int rounds, std::size_t & found, Cast cast) {
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++) {
+        for (const auto & object : objects) {
+            found += cast(*object) != nullptr;
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count()
+           / ((double) objects.size() * rounds);
+}
+
+TEST(libobj_benchmark, downcast) {
+    const int objects = 1024;
+    const int rounds = 2000;
+
+    std::vector<std::shared_ptr<Obj_Base>> mixed;
+    for (int i = 0; i < objects; i++) {
+        switch (i % 4) {
+            case 0: mixed.push_back(Obj::Create<Obj>()); break;
+            case 1: mixed.push_back(Obj::Create<Obj_Cast_Bench_A>()); break;
+            case 2: mixed.push_back(Obj::Create<Obj_Cast_Bench_B>()); break;
+            default: mixed.push_back(Obj::Create<Obj_Cast_Bench_C>()); break;
+        }
+    }
+
+    std::size_t dynamicFound = 0;
+    std::size_t objFound = 0;
+    double dynamicTime =
+        castObjects(mixed, rounds, dynamicFound, [](const Obj_Base & o) {
+            return dynamic_cast<const Obj_Cast_Bench_B *>(&o);
+        });
+    double objTime =
+        castObjects(mixed, rounds, objFound, [](const Obj_Base & o) {
+            return o.obj_cast<Obj_Cast_Bench_B>();
+        });
+    ASSERT_EQ(dynamicFound, objFound);
+
+    std::cout << "[BENCH] dynamic_cast downcast: " << dynamicTime << " ns\n";
+    std::cout << "[BENCH] obj_cast     downcast: " << objTime << " ns\n";
+}
+#endif
+
+struct Obj_Hash_Bench_A : public Obj {
+        LIBOBJ_BASE(Obj_Hash_Bench_A)
+
+        mutable std::size_t value = 1;
+
+        LIBOBJ_OVERRIDE__HASHCODE {
+            return value * 31;
+        }
+};
+
+struct Obj_Hash_Bench_B : public Obj {
+        LIBOBJ_BASE(Obj_Hash_Bench_B)
+
+        mutable std::size_t value = 2;
+
+        LIBOBJ_OVERRIDE__HASHCODE {
+            return value ^ 0x9e3779b9;
+        }
+};
+
+// hashes every object, returning the time per hash, sum keeps the loop from
+// being optimised away
+template <typename Objects, typename Hash>
+double hashObjects(const Objects & objects, int rounds, std::size_t & sum,
+                   Hash hash) {
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++) {
+        for (const auto & object : objects) {
+            sum += hash(object);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count()
+           / ((double) objects.size() * rounds);
+}
+
+TEST(libobj_benchmark, variant_hash) {
+    using Variant = ObjVariant<Obj_Hash_Bench_A, Obj_Hash_Bench_B>;
+    const int objects = 1024;
+    const int rounds = 2000;
+
+    std::vector<std::shared_ptr<Obj_Base>> shared;
+    std::vector<Variant> variants;
+    variants.reserve(objects);
+    for (int i = 0; i < objects; i++) {
+        if (i % 3 == 0) {
+            shared.push_back(Obj::Create<Obj_Hash_Bench_A>());
+            variants.push_back(Variant::Make<Obj_Hash_Bench_A>());
+        } else {
+            shared.push_back(Obj::Create<Obj_Hash_Bench_B>());
+            variants.push_back(Variant::Make<Obj_Hash_Bench_B>());
+        }
+    }
+
+    std::size_t virtualSum = 0;
+    std::size_t variantSum = 0;
+    double virtualTime = hashObjects(
+        shared, rounds, virtualSum,
+        [](const std::shared_ptr<Obj_Base> & o) { return o->hashCode(); });
+    double variantTime =
+        hashObjects(variants, rounds, variantSum,
+                    [](const Variant & v) { return v.hashCode(); });
+    ASSERT_EQ(virtualSum, variantSum);
+
+    std::cout << "[BENCH] virtual         hashCode: " << virtualTime
+              << " ns\n";
+    std::cout << "[BENCH] ObjVariant      hashCode: " << variantTime
+              << " ns\n";
+}
+
+// hashes a buffer of integers rounds times, returns the time per byte
+template <typename F>
+double hashBuffer(const std::vector<std::int64_t> & buffer, int rounds,
+                  std::size_t & sum, F && hash) {
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++) {
+        sum += hash(buffer);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count()
+           / ((double) buffer.size() * sizeof(std::int64_t) * rounds);
+}
+
+TEST(libobj_benchmark, range_hash) {
+    const int rounds = 200;
+    std::vector<std::int64_t> buffer(64 * 1024);
+    for (std::size_t i = 0; i < buffer.size(); i++) {
+        buffer[i] = i * 3;
+    }
+
+    std::size_t sum = 0;
+    double elementTime =
+        hashBuffer(buffer, rounds, sum, [](const std::vector<std::int64_t> & b) {
+            Obj_Base::HashCodeBuilder builder;
+            for (std::int64_t value : b) {
+                builder.add(value);
+            }
+            return builder.hash;
+        });
+    double bytesTime =
+        hashBuffer(buffer, rounds, sum, [](const std::vector<std::int64_t> & b) {
+            return Obj_Base::HashCodeBuilder()
+                .addBytes(b.data(), b.size() * sizeof(std::int64_t))
+                .hash;
+        });
+    double rangeTime =
+        hashBuffer(buffer, rounds, sum, [](const std::vector<std::int64_t> & b) {
+            return Obj_Base::HashCodeBuilder().addRange(b).hash;
+        });
+    ASSERT_NE(sum, 0u);
+
+    std::cout << "[BENCH] per element add: " << elementTime << " ns/byte\n";
+    std::cout << "[BENCH] addBytes:        " << bytesTime << " ns/byte\n";
+    std::cout << "[BENCH] addRange (" << Obj_Base::HashCodeBuilder::rangeKernel()
+              << "):  " << rangeTime << " ns/byte\n";
+}
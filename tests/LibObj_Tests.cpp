@@ -2,6 +2,14 @@
 
 #include <libobj.h>
 
+#include <algorithm>
+#include <cstring>
+#include <future>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
 using namespace LibObj;
 
 #define LOG(NAME) std::cout << "[LOG] " << #NAME << " = " << NAME << std::endl
@@ -77,3 +85,1352 @@ TEST(libobj, basic) {
     delete a_;
     delete b_;
 }
+
+struct Obj_Slab_Test : public Obj {
+        LIBOBJ_BASE(Obj_Slab_Test)
+        LIBOBJ_SLAB_ALLOCATED(Obj_Slab_Test)
+
+        mutable int value = 0;
+
+        LIBOBJ_OVERRIDE__FROM_COPY {
+            value = other.as<Obj_Slab_Test>().value;
+        }
+};
+
+TEST(libobj, slab) {
+    auto o = Obj::Create<Obj_Slab_Test>();
+    o->value = 5;
+    Obj_Slab_Test * a = o->clone();
+    ASSERT_EQ(a->value, 5);
+    delete a;
+    // the freed block is handed straight back out
+    Obj_Slab_Test * b = o->clone();
+    ASSERT_EQ(a, b);
+    ASSERT_EQ(b->value, 5);
+    Obj_Slab_Test * c = o->clone();
+    ASSERT_NE(b, c);
+    delete b;
+    delete c;
+}
+
+struct Obj_Arena_Test : public Obj {
+        LIBOBJ_BASE(Obj_Arena_Test)
+
+        static int alive;
+
+        mutable int value = 0;
+
+        Obj_Arena_Test() {
+            alive++;
+        }
+        Obj_Arena_Test(int value) : value(value) {
+            alive++;
+        }
+        ~Obj_Arena_Test() {
+            alive--;
+        }
+
+        LIBOBJ_OVERRIDE__FROM_COPY {
+            value = other.as<Obj_Arena_Test>().value;
+        }
+
+        LIBOBJ_OVERRIDE__FROM_MOVE {
+            value = other.as<Obj_Arena_Test>().value;
+        }
+};
+
+int Obj_Arena_Test::alive = 0;
+
+TEST(libobj, arena) {
+    {
+        Obj_Arena arena(256);
+        for (int round = 0; round < 3; round++) {
+            for (int i = 0; i < 100; i++) {
+                Obj_Arena_Test * o = Obj::CreateIn<Obj_Arena_Test>(arena, i);
+                ASSERT_EQ(o->value, i);
+                Obj_Base * c = o->cloneInto(arena);
+                ASSERT_EQ(c->as<Obj_Arena_Test>().value, i);
+                ASSERT_EQ(reinterpret_cast<std::uintptr_t>(c)
+                              % alignof(Obj_Arena_Test),
+                          0u);
+            }
+            ASSERT_EQ(Obj_Arena_Test::alive, 200);
+            arena.reset();
+            ASSERT_EQ(Obj_Arena_Test::alive, 0);
+        }
+        Obj::CreateIn<Obj_Arena_Test>(arena);
+        ASSERT_EQ(Obj_Arena_Test::alive, 1);
+    }
+    ASSERT_EQ(Obj_Arena_Test::alive, 0);
+}
+
+#ifdef LIBOBJ_INTRUSIVE_REFCOUNT
+TEST(libobj, objref) {
+    static_assert(sizeof(ObjRef<Obj>) == sizeof(Obj *), "");
+    {
+        ObjRef<Obj_Arena_Test> a = Obj::CreateRef<Obj_Arena_Test>(7);
+        ASSERT_EQ(Obj_Arena_Test::alive, 1);
+        ASSERT_EQ(a.useCount(), 1u);
+        ObjRef<Obj_Base> b = a;
+        ASSERT_EQ(a.useCount(), 2u);
+        ASSERT_EQ(a, b);
+        ASSERT_EQ(std::hash<ObjRef<Obj_Arena_Test>>()(a),
+                  std::hash<Obj_Arena_Test *>()(a.get()));
+        std::ostringstream os;
+        os << a;
+        ASSERT_EQ(os.str(), a->toString());
+
+        ObjRef<Obj_Arena_Test> c(a->clone());
+        ASSERT_EQ(Obj_Arena_Test::alive, 2);
+        ASSERT_EQ(c->value, 7);
+        ASSERT_NE(a, c);
+        c = a;
+        ASSERT_EQ(Obj_Arena_Test::alive, 1);
+        ASSERT_EQ(a.useCount(), 3u);
+        b.reset();
+        c = nullptr;
+        ASSERT_EQ(a.useCount(), 1u);
+    }
+    ASSERT_EQ(Obj_Arena_Test::alive, 0);
+}
+
+TEST(libobj, objref_local) {
+    {
+        LocalObjRef<Obj_Arena_Test> a = Obj::CreateLocal<Obj_Arena_Test>(3);
+        LocalObjRef<Obj_Base> b = a;
+        ASSERT_EQ(a.useCount(), 2u);
+        b = nullptr;
+        ASSERT_EQ(a.useCount(), 1u);
+        ASSERT_EQ(Obj_Arena_Test::alive, 1);
+    }
+    ASSERT_EQ(Obj_Arena_Test::alive, 0);
+}
+
+#ifdef LIBOBJ_REFCOUNT_THREAD_CHECK
+TEST(libobj, objref_local_cross_thread) {
+    ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+    auto a = Obj::CreateLocal<Obj>();
+    ASSERT_DEATH(std::thread([&a] { auto b = a; }).join(),
+                 "used on a thread other than the one that created it");
+}
+#endif
+#endif
+
+TEST(libobj, allocator) {
+    char buffer[4096];
+    std::pmr::monotonic_buffer_resource resource(
+        buffer, sizeof(buffer), std::pmr::null_memory_resource());
+    auto inBuffer = [&buffer](const void * p) {
+        return p >= buffer && p < buffer + sizeof(buffer);
+    };
+    {
+        std::shared_ptr<Obj_Arena_Test> a =
+            Obj::CreateWithAllocator<Obj_Arena_Test>(
+                std::pmr::polymorphic_allocator<Obj_Arena_Test>(&resource), 9);
+        ASSERT_TRUE(inBuffer(a.get()));
+        ASSERT_EQ(a->value, 9);
+
+        std::shared_ptr<Obj_Base> b = a->cloneWithAllocator(&resource);
+        ASSERT_TRUE(inBuffer(b.get()));
+        ASSERT_EQ(b->as<Obj_Arena_Test>().value, 9);
+        ASSERT_EQ(Obj_Arena_Test::alive, 2);
+    }
+    ASSERT_EQ(Obj_Arena_Test::alive, 0);
+}
+
+TEST(libobj, clone_into) {
+    auto o = Obj::Create<Obj_Arena_Test>(4);
+    const Obj_Base & base = *o;
+    ASSERT_EQ(base.getObjBaseSize(), sizeof(Obj_Arena_Test));
+    ASSERT_EQ(base.getObjBaseAlignment(), alignof(Obj_Arena_Test));
+
+    alignas(std::max_align_t) char buffer[sizeof(Obj_Arena_Test) + 1];
+    Obj_Base * c = base.clone_into(buffer, sizeof(buffer));
+    ASSERT_EQ(static_cast<void *>(c), static_cast<void *>(buffer));
+    ASSERT_EQ(c->as<Obj_Arena_Test>().value, 4);
+    ASSERT_EQ(Obj_Arena_Test::alive, 2);
+    c->~Obj_Base();
+    ASSERT_EQ(Obj_Arena_Test::alive, 1);
+
+    ASSERT_THROW(base.clone_into(buffer, sizeof(Obj_Arena_Test) - 1),
+                 std::runtime_error);
+    ASSERT_THROW(base.clone_into(buffer + 1, sizeof(Obj_Arena_Test)),
+                 std::runtime_error);
+    ASSERT_EQ(Obj_Arena_Test::alive, 1);
+}
+
+struct Obj_Clone_Throw_Test : public Obj_Arena_Test {
+        LIBOBJ_BASE_WITH_CUSTOM_CLONE(Obj_Clone_Throw_Test) {
+            throw std::runtime_error("clone failed");
+        }
+};
+
+TEST(libobj, clone_throw) {
+    Obj_Clone_Throw_Test o;
+    ASSERT_EQ(Obj_Arena_Test::alive, 1);
+
+    ASSERT_THROW(o.clone(), std::runtime_error);
+    ASSERT_EQ(Obj_Arena_Test::alive, 1);
+
+    alignas(Obj_Clone_Throw_Test) char buffer[sizeof(Obj_Clone_Throw_Test)];
+    ASSERT_THROW(o.clone_into(buffer, sizeof(buffer)), std::runtime_error);
+    ASSERT_EQ(Obj_Arena_Test::alive, 1);
+
+    {
+        Obj_Arena arena;
+        Obj::CreateIn<Obj_Arena_Test>(arena);
+        ASSERT_THROW(o.cloneInto(arena), std::runtime_error);
+        ASSERT_EQ(Obj_Arena_Test::alive, 2);
+    }
+    ASSERT_EQ(Obj_Arena_Test::alive, 1);
+}
+
+struct Obj_Box_Big_Test : public Obj_Arena_Test {
+        using Obj_Arena_Test::Obj_Arena_Test;
+        LIBOBJ_BASE(Obj_Box_Big_Test)
+
+        char payload[256] = {};
+};
+
+TEST(libobj, box) {
+    // vectors of boxes move them when they grow instead of cloning
+    static_assert(std::is_nothrow_move_constructible<ObjBox<64>>::value);
+    static_assert(std::is_nothrow_move_assignable<ObjBox<64>>::value);
+    {
+        std::vector<ObjBox<64>> boxes;
+        boxes.emplace_back(*Obj::Create<Obj_Arena_Test>(1));
+        boxes.push_back(ObjBox<64>::Make<Obj_Box_Big_Test>(2));
+        boxes.push_back(ObjBox<64>::Make<Obj_Arena_Test>(3));
+        ASSERT_EQ(Obj_Arena_Test::alive, 3);
+        ASSERT_TRUE(boxes[0].isInline());
+        ASSERT_FALSE(boxes[1].isInline());
+        ASSERT_TRUE(boxes[2].isInline());
+
+        // copies go through clone
+        std::vector<ObjBox<64>> copies = boxes;
+        ASSERT_EQ(Obj_Arena_Test::alive, 6);
+        for (std::size_t i = 0; i < boxes.size(); i++) {
+            ASSERT_NE(copies[i].get(), boxes[i].get());
+            ASSERT_TRUE(copies[i]->getObjId() == boxes[i]->getObjId());
+            ASSERT_EQ(copies[i]->as<Obj_Arena_Test>().value, (int) i + 1);
+        }
+
+        // moves keep the value, heap objects are handed over as is
+        Obj_Base * heap = copies[1].get();
+        ObjBox<64> moved = std::move(copies[1]);
+        ASSERT_EQ(moved.get(), heap);
+        ObjBox<64> movedInline = std::move(copies[0]);
+        ASSERT_TRUE(movedInline.isInline());
+        ASSERT_EQ(movedInline->as<Obj_Arena_Test>().value, 1);
+        ASSERT_FALSE(copies[0]);
+        ASSERT_EQ(Obj_Arena_Test::alive, 6);
+    }
+    ASSERT_EQ(Obj_Arena_Test::alive, 0);
+}
+
+TEST(libobj, slab_cross_thread) {
+    auto o = Obj::Create<Obj_Slab_Test>();
+    std::promise<Obj_Slab_Test *> produced;
+    std::promise<void> consumed;
+    Obj_Slab_Test * recycled = nullptr;
+    std::thread producer([&] {
+        produced.set_value(o->clone());
+        consumed.get_future().wait();
+        // the block freed by the consumer comes back to this thread
+        recycled = o->clone();
+    });
+    Obj_Slab_Test * p = produced.get_future().get();
+    delete p;
+    consumed.set_value();
+    producer.join();
+    ASSERT_EQ(recycled, p);
+
+    // the heap of the exited producer is adopted by the next thread,
+    // together with the blocks freed into it since
+    delete recycled;
+    Obj_Slab_Test * adopted = nullptr;
+    std::thread([&] {
+        adopted = o->clone();
+    }).join();
+    ASSERT_EQ(adopted, recycled);
+    delete adopted;
+}
+
+TEST(libobj, batch) {
+    std::shared_ptr<Obj_Arena_Test> kept;
+    {
+        Obj_Batch<Obj_Arena_Test> batch = Obj::CreateN<Obj_Arena_Test>(100, 8);
+        ASSERT_EQ(batch.size(), 100u);
+        ASSERT_EQ(Obj_Arena_Test::alive, 100);
+        for (std::size_t i = 0; i < batch.size(); i++) {
+            ASSERT_EQ(&batch[i], batch.begin() + i);
+            ASSERT_EQ(batch[i].value, 8);
+        }
+        kept = batch.handle(42);
+        ASSERT_EQ(kept.get(), &batch[42]);
+    }
+    // a handle keeps the whole batch alive
+    ASSERT_EQ(Obj_Arena_Test::alive, 100);
+    ASSERT_EQ(kept->value, 8);
+    kept.reset();
+    ASSERT_EQ(Obj_Arena_Test::alive, 0);
+
+    ASSERT_THROW(Obj::CreateN<Obj_Arena_Test>(SIZE_MAX / 2, 8),
+                 std::bad_array_new_length);
+    ASSERT_EQ(Obj_Arena_Test::alive, 0);
+}
+
+struct Obj_Pool_Test : public Obj_Arena_Test {
+        LIBOBJ_BASE(Obj_Pool_Test)
+
+        static int constructed;
+
+        Obj_Pool_Test() {
+            constructed++;
+        }
+
+        LIBOBJ_OVERRIDE__RESET {
+            value = 0;
+        }
+};
+
+int Obj_Pool_Test::constructed = 0;
+
+TEST(libobj, pool) {
+    {
+        ObjPool<Obj_Pool_Test> pool(2);
+        Obj_Pool_Test * first;
+        {
+            auto a = pool.acquire();
+            a->value = 3;
+            first = a.get();
+        }
+        ASSERT_EQ(pool.available(), 1u);
+        for (int i = 0; i < 10; i++) {
+            auto a = pool.acquire();
+            // the same object comes back, reset rather than rebuilt
+            ASSERT_EQ(a.get(), first);
+            ASSERT_EQ(a->value, 0);
+            a->value = i;
+        }
+        ASSERT_EQ(Obj_Pool_Test::constructed, 1);
+
+        {
+            auto a = pool.acquire();
+            auto b = pool.acquire();
+            auto c = pool.acquire();
+            ASSERT_EQ(Obj_Arena_Test::alive, 3);
+        }
+        // only capacity objects are kept
+        ASSERT_EQ(pool.available(), 2u);
+        ASSERT_EQ(Obj_Arena_Test::alive, 2);
+    }
+    ASSERT_EQ(Obj_Arena_Test::alive, 0);
+}
+
+TEST(libobj, type_id) {
+    static_assert(Obj_TypeIdOf<Obj> != Obj_TypeIdOf<Obj_Example<int>>, "");
+    static_assert(Obj_TypeIdOf<Obj_Example<int>>
+                      != Obj_TypeIdOf<Obj_Example<float>>,
+                  "");
+    static_assert(Obj_TypeName::of<Obj>() == "LibObj::Obj", "");
+    static_assert(Obj_TypeIdOf<Obj> == Obj_TypeName::hash("LibObj::Obj"), "");
+
+    auto a = Obj::Create<Obj_Arena_Test>();
+    auto b = Obj::Create<Obj_Pool_Test>();
+    const Obj_Base & base = *b;
+    ASSERT_EQ(a->getObjTypeId(), Obj_TypeIdOf<Obj_Arena_Test>);
+    ASSERT_EQ(base.getObjTypeId(), Obj_TypeIdOf<Obj_Pool_Test>);
+    ASSERT_TRUE(a->getObjId() != base.getObjId());
+    ASSERT_TRUE(base.getObjId() == Obj::Create<Obj_Pool_Test>()->getObjId());
+    ASSERT_EQ(base.getObjTypeDescriptor().name, "Obj_Pool_Test");
+    std::string name = base.getObjId().nameString();
+    ASSERT_EQ(name, base.getObjId().name());
+#ifndef RTTI_ENABLED
+    ASSERT_EQ(base.getObjId().name(), "Obj_Pool_Test");
+    // read from the descriptor, not looked up in the registry
+    ASSERT_EQ(base.getObjId().name().data(),
+              base.getObjTypeDescriptor().name.data());
+#endif
+}
+
+#ifdef RTTI_ENABLED
+// shares the id of Obj_Arena_Test, but not its typeid
+struct Obj_Same_Id_Test : public Obj_Arena_Test {};
+
+TEST(libobj, type_id_rtti) {
+    auto a = Obj::Create<Obj_Arena_Test>();
+    auto b = Obj::Create<Obj_Same_Id_Test>();
+    ASSERT_EQ(a->getObjTypeId(), b->getObjTypeId());
+    ASSERT_TRUE(a->getObjId() != b->getObjId());
+}
+#endif
+
+TEST(libobj, interned_name) {
+    auto a = Obj::Create<Obj_Example<int>>();
+    std::string_view first = a->getObjId().name();
+    std::string_view second =
+        Obj::Create<Obj_Example<int>>()->getObjId().name();
+    ASSERT_EQ(first, "LibObj::Obj_Example<int>");
+    // the same interned storage is handed out every time
+    ASSERT_EQ(first.data(), second.data());
+    ASSERT_NE(first, Obj::Create<Obj>()->getObjId().name());
+}
+
+namespace {
+    struct Obj_Anonymous_Test : public Obj {
+            LIBOBJ_BASE(Obj_Anonymous_Test)
+    };
+} // namespace
+
+TEST(libobj, registry) {
+    const Obj_Registry_Entry * entry =
+        Obj_Registry::findById(Obj_TypeIdOf<Obj_Arena_Test>);
+    ASSERT_NE(entry, nullptr);
+    ASSERT_EQ(entry->type, &Obj_TypeDescriptorOf<Obj_Arena_Test>);
+    ASSERT_EQ(entry->type->name, "Obj_Arena_Test");
+    ASSERT_EQ(Obj_Registry::findByName("Obj_Arena_Test"), entry);
+    ASSERT_EQ(Obj_Registry::findByName(entry->demangledName), entry);
+
+    // class templates register each instantiation that is used
+    auto a = Obj::Create<Obj_Example2<int>>();
+    Obj_Base * b = Obj_Registry::createByName("LibObj::Obj_Example2<int>");
+    ASSERT_NE(b, nullptr);
+    ASSERT_TRUE(b->getObjId() == a->getObjId());
+    delete b;
+
+    int alive = Obj_Arena_Test::alive;
+    Obj_Base * c = Obj_Registry::createById(Obj_TypeIdOf<Obj_Arena_Test>);
+    ASSERT_EQ(c->getObjTypeId(), Obj_TypeIdOf<Obj_Arena_Test>);
+    ASSERT_EQ(Obj_Arena_Test::alive, alive + 1);
+    delete c;
+
+    ASSERT_EQ(Obj_Registry::findById(0), nullptr);
+    ASSERT_EQ(Obj_Registry::findByName("Obj_Not_Registered"), nullptr);
+    ASSERT_EQ(Obj_Registry::createByName("Obj_Not_Registered"), nullptr);
+
+    // registering the same class again is harmless
+    std::size_t size = Obj_Registry::size();
+    Obj_Registry::add(Obj_RegistryEntryOf<Obj_Arena_Test>);
+    ASSERT_EQ(Obj_Registry::size(), size);
+
+    // a different class with the same id does not throw while registering,
+    // which happens during static initialisation, but looking it up does
+    static Obj_Registry_Entry first;
+    static constexpr Obj_TypeDescriptor firstType {
+        Obj_TypeName::hash("Obj_Clash"), "Obj_Clash", 1, 1, nullptr, nullptr,
+        0, &first};
+    first.type = &firstType;
+    first.demangledName = firstType.name;
+    Obj_Registry::add(first);
+    ASSERT_EQ(Obj_Registry::findById(firstType.id), &first);
+    static Obj_Registry_Entry clash;
+    static constexpr Obj_TypeDescriptor clashType {
+        firstType.id, "Obj_Other_Clash", 1, 1, nullptr, nullptr, 0, &clash};
+    clash.type = &clashType;
+    clash.demangledName = clashType.name;
+    Obj_Registry::add(clash);
+    ASSERT_EQ(Obj_Registry::size(), size + 2);
+    ASSERT_THROW(Obj_Registry::findById(firstType.id), std::runtime_error);
+    ASSERT_THROW(Obj_Registry::findByName("Obj_Clash"), std::runtime_error);
+    ASSERT_THROW(Obj_Registry::createById(firstType.id), std::runtime_error);
+
+    // so does a different class with the same name
+    static Obj_Registry_Entry second;
+    static constexpr Obj_TypeDescriptor secondType {
+        Obj_TypeName::hash("Obj_Same_Name"), "Obj_Same_Name", 1, 1, nullptr,
+        nullptr, 0, &second};
+    second.type = &secondType;
+    second.demangledName = secondType.name;
+    Obj_Registry::add(second);
+    static Obj_Registry_Entry sameName;
+    static constexpr Obj_TypeDescriptor sameNameType {
+        secondType.id, secondType.name, 2, 1, nullptr, nullptr, 0, &sameName};
+    sameName.type = &sameNameType;
+    sameName.demangledName = sameNameType.name;
+    Obj_Registry::add(sameName);
+    ASSERT_THROW(Obj_Registry::findByName("Obj_Same_Name"),
+                 std::runtime_error);
+
+    // classes in anonymous namespaces are never the same class seen twice,
+    // as one in another translation unit would be, each is numbered on its
+    // own so is() still tells them apart
+    ASSERT_TRUE(Obj_TypeDescriptorOf<Obj_Anonymous_Test>.is(
+        Obj_TypeDescriptor::Anonymous));
+    ASSERT_FALSE(Obj_TypeDescriptorOf<Obj_Arena_Test>.is(
+        Obj_TypeDescriptor::Anonymous));
+    auto local = Obj::Create<Obj_Anonymous_Test>();
+    static Obj_Registry_Entry anonymous;
+    static Obj_TypeDescriptor anonymousType =
+        Obj_TypeDescriptorOf<Obj_Anonymous_Test>;
+    anonymousType.entry = &anonymous;
+    anonymous.type = &anonymousType;
+    anonymous.demangledName = anonymousType.name;
+    ASSERT_NO_THROW(Obj_Registry::add(anonymous));
+    ASSERT_FALSE(anonymousType.sameClass(local->getObjTypeDescriptor()));
+    ASSERT_NE(anonymous.first, Obj_RegistryEntryOf<Obj_Anonymous_Test>.first);
+    ASSERT_TRUE(local->is<Obj_Anonymous_Test>());
+    ASSERT_TRUE(local->is<Obj>());
+    ASSERT_THROW(Obj_Registry::findById(Obj_TypeIdOf<Obj_Anonymous_Test>),
+                 std::runtime_error);
+}
+
+TEST(libobj, obj_cast) {
+    static_assert(std::is_same<Obj_ParentOf<Obj>, Obj_Base>::value, "");
+    static_assert(std::is_same<Obj_ParentOf<Obj_Arena_Test>, Obj>::value, "");
+    static_assert(
+        std::is_same<Obj_ParentOf<Obj_Pool_Test>, Obj_Arena_Test>::value, "");
+    // Obj_Example_Base is not set up via a macro and is skipped
+    static_assert(std::is_same<Obj_ParentOf<Obj_Example<int>>, Obj>::value, "");
+    static_assert(
+        std::is_same<Obj_SelfOf<Obj_Example_Base>, Obj>::value, "");
+
+    auto a = Obj::Create<Obj_Arena_Test>();
+    auto b = Obj::Create<Obj_Pool_Test>();
+    auto c = Obj::Create<Obj_Box_Big_Test>();
+    const Obj_Base & base = *b;
+
+    ASSERT_TRUE(base.is<Obj_Base>());
+    ASSERT_TRUE(base.is<Obj>());
+    ASSERT_TRUE(base.is<Obj_Arena_Test>());
+    ASSERT_TRUE(base.is<Obj_Pool_Test>());
+    ASSERT_FALSE(base.is<Obj_Box_Big_Test>());
+    ASSERT_FALSE(base.is<Obj_Example<int>>());
+    ASSERT_TRUE(a->is<Obj_Arena_Test>());
+    ASSERT_FALSE(a->is<Obj_Pool_Test>());
+    ASSERT_TRUE(c->is<Obj_Arena_Test>());
+
+    ASSERT_EQ(base.obj_cast<Obj_Arena_Test>(), b.get());
+    ASSERT_EQ(base.obj_cast<Obj_Box_Big_Test>(), nullptr);
+    ASSERT_EQ(c->obj_cast<Obj_Pool_Test>(), nullptr);
+
+    // Obj_Example2<long> is never constructed but still registered
+    ASSERT_FALSE(base.is<Obj_Example2<long>>());
+
+    // every registered class nests inside the interval of its parent
+    for (const Obj_Registry_Entry * e :
+         {&Obj_RegistryEntryOf<Obj_Pool_Test>,
+          &Obj_RegistryEntryOf<Obj_Box_Big_Test>,
+          &Obj_RegistryEntryOf<Obj_Example2<int>>}) {
+        ASSERT_NE(e->first, 0u);
+        for (const Obj_TypeDescriptor * p = e->type->parent; p != nullptr;
+             p = p->parent) {
+            ASSERT_LT(p->entry->first, e->first);
+            ASSERT_GE(p->entry->last, e->last);
+        }
+    }
+}
+
+TEST(libobj, obj_cast_while_registering) {
+    auto a = Obj::Create<Obj_Arena_Test>();
+    auto b = Obj::Create<Obj_Pool_Test>();
+    auto c = Obj::Create<Obj_Box_Big_Test>();
+
+    // classes registered at run time, as a shared library opened with
+    // dlopen would, as subclasses of whichever of the two siblings comes
+    // first, so each registration renumbers the other one
+    const Obj_TypeDescriptor & parent =
+        Obj_RegistryEntryOf<Obj_Pool_Test>.first
+                < Obj_RegistryEntryOf<Obj_Box_Big_Test>.first
+            ? Obj_TypeDescriptorOf<Obj_Pool_Test>
+            : Obj_TypeDescriptorOf<Obj_Box_Big_Test>;
+    constexpr int count = 2000;
+    static Obj_Registry_Entry entries[count];
+    static Obj_TypeDescriptor types[count];
+    static std::string names[count];
+
+    std::atomic<bool> done {false};
+    std::atomic<int> started {0};
+    std::atomic<int> wrong {0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; t++) {
+        readers.emplace_back([&] {
+            started++;
+            while (!done.load()) {
+                bool right = a->is<Obj>() && a->is<Obj_Arena_Test>()
+                             && !a->is<Obj_Pool_Test>()
+                             && !a->is<Obj_Box_Big_Test>()
+                             && b->is<Obj_Arena_Test>()
+                             && b->is<Obj_Pool_Test>()
+                             && !b->is<Obj_Box_Big_Test>()
+                             && c->is<Obj_Arena_Test>()
+                             && c->is<Obj_Box_Big_Test>()
+                             && c->obj_cast<Obj_Pool_Test>() == nullptr;
+                if (!right) {
+                    wrong++;
+                }
+            }
+        });
+    }
+    while (started.load() < 4) {
+        std::this_thread::yield();
+    }
+    for (int i = 0; i < count; i++) {
+        names[i] = "Obj_Registered_Late_" + std::to_string(i);
+        types[i] = {Obj_TypeName::hash(names[i]),
+                    names[i],
+                    parent.size,
+                    parent.alignment,
+                    &parent,
+                    nullptr,
+                    Obj_TypeDescriptor::Abstract,
+                    &entries[i]};
+        entries[i].type = &types[i];
+        entries[i].demangledName = names[i];
+        Obj_Registry::add(entries[i]);
+    }
+    done = true;
+    for (std::thread & reader : readers) {
+        reader.join();
+    }
+    ASSERT_EQ(wrong.load(), 0);
+    ASSERT_EQ(Obj_Registry::findByName("Obj_Registered_Late_0"), &entries[0]);
+}
+
+#ifdef LIBOBJ_TEST_COMPILE_ERRORS
+// must not compile: a local class can have neither the static data member
+// nor the friend declarations the LIBOBJ_BASE macros add
+TEST(libobj, local_class) {
+    struct Obj_Local_Test : public Obj {
+            LIBOBJ_BASE(Obj_Local_Test)
+    };
+}
+#endif
+
+TEST(libobj, type_descriptor) {
+    constexpr const Obj_TypeDescriptor & pool =
+        Obj_TypeDescriptorOf<Obj_Pool_Test>;
+    static_assert(pool.size == sizeof(Obj_Pool_Test), "");
+    static_assert(pool.alignment == alignof(Obj_Pool_Test), "");
+    static_assert(pool.id == Obj_TypeIdOf<Obj_Pool_Test>, "");
+    static_assert(pool.parent == &Obj_TypeDescriptorOf<Obj_Arena_Test>, "");
+    static_assert(Obj_TypeDescriptorOf<Obj>.parent == nullptr, "");
+    static_assert(pool.flags == 0, "");
+    static_assert(Obj_TypeDescriptorOf<Obj_Slab_Test>.flags
+                      == Obj_TypeDescriptor::SlabAllocated,
+                  "");
+
+    auto a = Obj::Create<Obj_Pool_Test>();
+    const Obj_Base & base = *a;
+    ASSERT_EQ(&base.getObjTypeDescriptor(), &pool);
+    ASSERT_EQ(base.getObjBaseSize(), sizeof(Obj_Pool_Test));
+
+    Obj_Base * b = pool.factory();
+    ASSERT_EQ(b->getObjTypeId(), pool.id);
+    delete b;
+
+    // grouping objects by type reads one descriptor per object
+    std::vector<std::shared_ptr<Obj_Base>> objects {
+        Obj::Create<Obj>(), Obj::Create<Obj_Pool_Test>(),
+        Obj::Create<Obj>(), Obj::Create<Obj_Slab_Test>()};
+    std::size_t total = 0;
+    std::size_t slab = 0;
+    for (const auto & object : objects) {
+        const Obj_TypeDescriptor & type = object->getObjTypeDescriptor();
+        total += type.size;
+        slab += type.is(Obj_TypeDescriptor::SlabAllocated);
+    }
+    ASSERT_EQ(total, 2 * sizeof(Obj) + sizeof(Obj_Pool_Test)
+                         + sizeof(Obj_Slab_Test));
+    ASSERT_EQ(slab, 1u);
+}
+
+#ifdef LIBOBJ_CLONE_TYPE_CHECK
+// forgets to use one of the LIBOBJ_BASE macros, so it would be cloned as an
+// Obj_Arena_Test
+struct Obj_No_Macro_Test : public Obj_Arena_Test {};
+
+TEST(libobj, clone_type_check) {
+    auto a = Obj::Create<Obj_No_Macro_Test>();
+    const Obj_Base & base = *a;
+    ASSERT_THROW(delete base.clone(), std::runtime_error);
+    alignas(std::max_align_t) unsigned char buffer[sizeof(Obj_Arena_Test)];
+    ASSERT_THROW(base.clone_into(buffer, sizeof(buffer)), std::runtime_error);
+    ASSERT_THROW(ObjBox<>(std::move(*a)), std::runtime_error);
+
+    auto b = Obj::Create<Obj_Arena_Test>();
+    delete b->clone();
+}
+#endif
+
+TEST(libobj, variant) {
+    using Variant = ObjVariant<Obj_Arena_Test, Obj_Pool_Test, Obj>;
+    static_assert(std::is_nothrow_move_constructible<Variant>::value);
+    static_assert(std::is_nothrow_move_assignable<Variant>::value);
+    int alive = Obj_Arena_Test::alive;
+    {
+        Variant a;
+        ASSERT_EQ(a.index(), 0u);
+        ASSERT_TRUE(a.holds<Obj_Arena_Test>());
+        ASSERT_EQ(Obj_Arena_Test::alive, alive + 1);
+
+        Variant b = Variant::Make<Obj_Arena_Test>(7);
+        ASSERT_EQ(b.get<Obj_Arena_Test>()->value, 7);
+        ASSERT_EQ(b.get<Obj_Pool_Test>(), nullptr);
+        ASSERT_EQ(b.getObjTypeId(), Obj_TypeIdOf<Obj_Arena_Test>);
+
+        // a variant is an Obj_Base
+        const Obj_Base & base = b;
+        ASSERT_EQ(base.getObjTypeId(), b.getObjTypeId());
+        ASSERT_EQ(b.hashCode(), base.hashCode());
+        std::ostringstream o;
+        o << b;
+        ASSERT_EQ(o.str(), base.toString());
+
+        Variant c(b);
+        ASSERT_EQ(c.get<Obj_Arena_Test>()->value, 7);
+        // Obj hashes, and therefore compares, by identity
+        ASSERT_TRUE(b == b);
+        ASSERT_TRUE(c != b);
+
+        Variant d = Variant::Make<Obj_Pool_Test>();
+        ASSERT_TRUE(d != b);
+        d = c;
+        ASSERT_TRUE(d.holds<Obj_Arena_Test>());
+        ASSERT_EQ(d.get<Obj_Arena_Test>()->value, 7);
+
+        Variant e(std::move(d));
+        ASSERT_EQ(e.get<Obj_Arena_Test>()->value, 7);
+
+        // from any object of one of the classes
+        auto pool = Obj::Create<Obj_Pool_Test>();
+        Variant f(*pool);
+        ASSERT_TRUE(f.holds<Obj_Pool_Test>());
+        ASSERT_THROW(Variant(*Obj::Create<Obj_Box_Big_Test>()),
+                     std::runtime_error);
+
+        std::size_t visited = f.visit([](const auto & obj) {
+            return Obj_TypeIdOf<std::decay_t<decltype(obj)>>;
+        });
+        ASSERT_EQ(visited, Obj_TypeIdOf<Obj_Pool_Test>);
+    }
+    ASSERT_EQ(Obj_Arena_Test::alive, alive);
+}
+
+struct Obj_Static_Test final : public StaticObj<Obj_Static_Test> {
+        mutable int value = 0;
+
+        Obj_Static_Test() = default;
+        Obj_Static_Test(int value) : value(value) {}
+
+        void from(const Obj_Static_Test & other) const {
+            value = other.value;
+        }
+
+        void from(Obj_Static_Test && other) const {
+            value = other.value;
+            other.value = 0;
+        }
+
+        std::size_t hashCode() const {
+            return Obj_Base::HashCodeBuilder().add(value).hash;
+        }
+
+        std::ostream & toStream(std::ostream & os) const {
+            return os << "Obj_Static_Test(" << value << ")";
+        }
+};
+
+TEST(libobj, static_obj) {
+    static_assert(!std::is_polymorphic<Obj_Static_Test>::value, "");
+    static_assert(sizeof(Obj_Static_Test) == sizeof(int), "");
+    static_assert(Obj_Static_Test::getObjTypeId()
+                      == Obj_TypeIdOf<Obj_Static_Test>,
+                  "");
+
+    Obj_Static_Test a(5);
+    Obj_Static_Test * b = a.clone();
+    ASSERT_EQ(b->value, 5);
+    ASSERT_TRUE(a == *b);
+    b->value = 6;
+    ASSERT_TRUE(a != *b);
+    delete b;
+    ASSERT_EQ(a.toString(), "Obj_Static_Test(5)");
+
+    // the adaptor takes part in anything that takes an Obj_Base
+    std::shared_ptr<Obj_Base> o = a.toObj();
+    ASSERT_EQ(o->hashCode(), a.hashCode());
+    ASSERT_EQ(o->toString(), "Obj_Static_Test(5)");
+    ASSERT_TRUE(o->is<StaticObjAdaptor<Obj_Static_Test>>());
+    Obj_Base * c = o->clone();
+    ASSERT_EQ(c->as<StaticObjAdaptor<Obj_Static_Test>>().value.value, 5);
+    ASSERT_TRUE(*c == *o);
+    delete c;
+
+    auto d = Obj_Static_Test(7).toObj();
+    ASSERT_EQ(d->value.value, 7);
+    ASSERT_FALSE(*d == *o);
+}
+
+struct Obj_Number_Test : public Obj {
+        LIBOBJ_BASE(Obj_Number_Test)
+
+        mutable int value = 0;
+};
+
+struct Obj_Text_Test : public Obj {
+        LIBOBJ_BASE(Obj_Text_Test)
+
+        mutable std::string value;
+};
+
+template <int N>
+struct Obj_Chain_Test : public Obj {
+        LIBOBJ_BASE(Obj_Chain_Test<N>)
+
+        mutable int value = 0;
+};
+
+template <int... N>
+void addChainConversions(std::integer_sequence<int, N...>) {
+    (Obj_Conversions::add<Obj_Chain_Test<N>, Obj_Chain_Test<N + 1>>(
+         [](const Obj_Chain_Test<N + 1> & to, const Obj_Chain_Test<N> & from) {
+             to.value = from.value + 1;
+         }),
+     ...);
+}
+
+TEST(libobj, conversions) {
+    Obj_Conversions::add<Obj_Number_Test, Obj_Text_Test>(
+        [](const Obj_Text_Test & to, const Obj_Number_Test & from) {
+            to.value = std::to_string(from.value);
+        });
+    Obj_Conversions::add<Obj_Text_Test, Obj_Number_Test>(
+        [](const Obj_Number_Test & to, const Obj_Text_Test & from) {
+            to.value = std::stoi(from.value);
+        });
+
+    auto number = Obj::Create<Obj_Number_Test>();
+    auto text = Obj::Create<Obj_Text_Test>();
+    number->value = 42;
+    // Obj::from converts through the table
+    text->from(*number);
+    ASSERT_EQ(text->value, "42");
+    text->value = "7";
+    ASSERT_TRUE(Obj_Conversions::convert(*number, *text));
+    ASSERT_EQ(number->value, 7);
+
+    // no converter from Obj_Number_Test to itself
+    auto other = Obj::Create<Obj_Number_Test>();
+    ASSERT_FALSE(Obj_Conversions::convert(*other, *number));
+    ASSERT_EQ(other->value, 0);
+    ASSERT_FALSE(Obj_Conversions::convert(*number, *Obj::Create<Obj>()));
+
+    // enough classes for the table to grow
+    addChainConversions(std::make_integer_sequence<int, 20>());
+    auto first = Obj::Create<Obj_Chain_Test<0>>();
+    auto last = Obj::Create<Obj_Chain_Test<20>>();
+    std::shared_ptr<Obj_Base> current = first;
+    first->value = 100;
+    auto step = [](const std::shared_ptr<Obj_Base> & from, auto to) {
+        to->from(*from);
+        return std::shared_ptr<Obj_Base>(to);
+    };
+    current = step(current, Obj::Create<Obj_Chain_Test<1>>());
+    current = step(current, Obj::Create<Obj_Chain_Test<2>>());
+    ASSERT_EQ(current->as<Obj_Chain_Test<2>>().value, 102);
+    ASSERT_TRUE(Obj_Conversions::convert(
+        *last, *Obj::Create<Obj_Chain_Test<19>>()));
+    ASSERT_EQ(last->value, 1);
+    // the earlier converters survive the table growing
+    number->value = 5;
+    text->from(*number);
+    ASSERT_EQ(text->value, "5");
+
+    std::size_t found = 0;
+    for (const auto & conversion : Obj_Conversions::list()) {
+        if (conversion.from == &Obj_TypeDescriptorOf<Obj_Number_Test>) {
+            ASSERT_EQ(conversion.to, &Obj_TypeDescriptorOf<Obj_Text_Test>);
+            found++;
+        }
+    }
+    ASSERT_EQ(found, 1u);
+    ASSERT_GE(Obj_Conversions::list().size(), 22u);
+}
+
+TEST(libobj, pointer_assign) {
+    int a = 1;
+    const int b = 2;
+    int * to = nullptr;
+    const int * toConst = nullptr;
+
+    // Obj_PointerAssign(to, &b) does not compile
+    Obj_PointerAssign(to, &a);
+    Obj_PointerAssign(toConst, &b);
+    ASSERT_EQ(to, &a);
+    ASSERT_EQ(toConst, &b);
+
+    auto nonConst = Obj::Create<Obj_Example2<int>>(&a);
+    auto isConst = Obj::Create<Obj_Example2<const int>>(&b);
+    int * value = nullptr;
+    const int * constValue = nullptr;
+    static_assert(noexcept(LIBOBJ_POINTER_TRY_ASSIGN(
+                      Obj_Example_Base, (*isConst), value, getPointer())),
+                  "");
+    ASSERT_FALSE(LIBOBJ_POINTER_TRY_ASSIGN(Obj_Example_Base, (*isConst), value,
+                                           getPointer()));
+    ASSERT_EQ(value, nullptr);
+    ASSERT_TRUE(LIBOBJ_POINTER_TRY_ASSIGN(Obj_Example_Base, (*nonConst), value,
+                                          getPointer()));
+    ASSERT_EQ(value, &a);
+    ASSERT_TRUE(LIBOBJ_POINTER_TRY_ASSIGN(Obj_Example_Base, (*isConst),
+                                          constValue, getPointer()));
+    ASSERT_EQ(constValue, &b);
+
+    // the throwing form
+    ASSERT_THROW(nonConst->from(*isConst), std::runtime_error);
+    ASSERT_EQ(nonConst->value, &a);
+    isConst->from(*nonConst);
+    ASSERT_EQ(isConst->value, &a);
+}
+
+struct Obj_Cached_Hash_Test : public Obj {
+        LIBOBJ_BASE(Obj_Cached_Hash_Test)
+
+        static int computed;
+
+        mutable std::vector<int> values;
+
+        void add(int value) const {
+            values.push_back(value);
+            markDirty();
+        }
+
+        LIBOBJ_OVERRIDE__FROM_COPY {
+            values = other.as<Obj_Cached_Hash_Test>().values;
+            markDirty();
+        }
+
+        LIBOBJ_OVERRIDE__CACHED_HASHCODE(Obj_Cached_Hash_Test) {
+            computed++;
+            HashCodeBuilder builder;
+            for (int value : values) {
+                builder.add(value);
+            }
+            return builder.hash;
+        }
+};
+
+int Obj_Cached_Hash_Test::computed = 0;
+
+struct Obj_Cached_Hash_Derived_Test : public Obj_Cached_Hash_Test {
+        LIBOBJ_BASE(Obj_Cached_Hash_Derived_Test)
+
+        static int computed;
+
+        LIBOBJ_OVERRIDE__CACHED_HASHCODE(Obj_Cached_Hash_Derived_Test) {
+            computed++;
+            return Obj_Cached_Hash_Test::hashCode() * 31;
+        }
+};
+
+int Obj_Cached_Hash_Derived_Test::computed = 0;
+
+TEST(libobj, cached_hash) {
+    auto a = Obj::Create<Obj_Cached_Hash_Test>();
+    auto b = Obj::Create<Obj_Cached_Hash_Test>();
+    a->add(1);
+    a->add(2);
+    b->add(1);
+    int computed = Obj_Cached_Hash_Test::computed;
+    std::size_t hash = a->hashCode();
+    for (int i = 0; i < 10; i++) {
+        ASSERT_EQ(a->hashCode(), hash);
+        ASSERT_FALSE(*a == *b);
+    }
+    ASSERT_EQ(Obj_Cached_Hash_Test::computed, computed + 2);
+
+    b->add(2);
+    ASSERT_TRUE(*a == *b);
+    ASSERT_EQ(Obj_Cached_Hash_Test::computed, computed + 3);
+
+    Obj_Cached_Hash_Test empty_test;
+    b->from(empty_test);
+    ASSERT_EQ(b->hashCode(), empty_test.hashCode());
+
+    // a mutator of the base class invalidates the cache of the subclass
+    auto c = Obj::Create<Obj_Cached_Hash_Derived_Test>();
+    std::size_t empty = c->hashCode();
+    ASSERT_EQ(c->hashCode(), empty);
+    ASSERT_EQ(Obj_Cached_Hash_Derived_Test::computed, 1);
+    c->add(3);
+    ASSERT_NE(c->hashCode(), empty);
+    ASSERT_EQ(Obj_Cached_Hash_Derived_Test::computed, 2);
+}
+
+// the fraction of output bits that flip when one input bit flips, for every
+// pair of input and output bit, should be close to one half
+template <typename F>
+static void check_avalanche(F && hash, std::size_t input_bytes) {
+    const int samples = 256;
+    std::size_t input_bits = input_bytes * 8;
+    std::vector<int> flips(input_bits * 64);
+    std::uint64_t state = 0x1234567;
+    for (int s = 0; s < samples; s++) {
+        std::vector<unsigned char> input(input_bytes);
+        for (auto & byte : input) {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+            byte = static_cast<unsigned char>(state >> 56);
+        }
+        std::uint64_t h = hash(input);
+        for (std::size_t i = 0; i < input_bits; i++) {
+            input[i / 8] ^= 1 << (i % 8);
+            std::uint64_t diff = h ^ hash(input);
+            input[i / 8] ^= 1 << (i % 8);
+            for (int o = 0; o < 64; o++) {
+                flips[i * 64 + o] += (diff >> o) & 1;
+            }
+        }
+    }
+    for (std::size_t i = 0; i < flips.size(); i++) {
+        double p = flips[i] / double(samples);
+        ASSERT_GT(p, 0.3) << "input bit " << i / 64 << " output bit " << i % 64;
+        ASSERT_LT(p, 0.7) << "input bit " << i / 64 << " output bit " << i % 64;
+    }
+}
+
+TEST(libobj, hash_mixing) {
+    using Builder = Obj_Base::HashCodeBuilder;
+
+    check_avalanche(
+        [](const std::vector<unsigned char> & input) {
+            std::uint64_t value;
+            std::memcpy(&value, input.data(), 8);
+            return Builder().add(value).hash;
+        },
+        8);
+    for (std::size_t size : {3, 8, 16, 24, 40, 100}) {
+        check_avalanche(
+            [](const std::vector<unsigned char> & input) {
+                return Builder().addBytes(input.data(), input.size()).hash;
+            },
+            size);
+    }
+
+    // no collisions between small integers, pairs of them, or strings
+    std::unordered_set<std::size_t> seen;
+    for (int i = 0; i < 1 << 16; i++) {
+        ASSERT_TRUE(seen.insert(Builder().add(i).hash).second);
+    }
+    seen.clear();
+    for (int i = 0; i < 256; i++) {
+        for (int j = 0; j < 256; j++) {
+            ASSERT_TRUE(seen.insert(Builder().add(i).add(j).hash).second);
+        }
+    }
+    seen.clear();
+    for (int i = 0; i < 1 << 16; i++) {
+        ASSERT_TRUE(seen.insert(Builder().add(std::to_string(i)).hash).second);
+    }
+    ASSERT_NE(Builder().add(1).add(2).hash, Builder().add(2).add(1).hash);
+    ASSERT_EQ(Builder().add(std::string("abc")).hash,
+              Builder().add(std::string_view("abc")).hash);
+
+    // aligned addresses fill the low bits of a table evenly
+    const std::size_t buckets = 1024;
+    std::vector<int> counts(buckets);
+    for (std::uintptr_t i = 0; i < buckets * 16; i++) {
+        counts[Builder().add(reinterpret_cast<void *>(i * 64)).hash
+               % buckets]++;
+    }
+    ASSERT_LT(*std::max_element(counts.begin(), counts.end()), 48);
+    ASSERT_GT(*std::min_element(counts.begin(), counts.end()), 0);
+}
+
+TEST(libobj, hash_range) {
+    using Builder = Obj_Base::HashCodeBuilder;
+
+    check_avalanche(
+        [](const std::vector<unsigned char> & input) {
+            return Builder().addRange(input).hash;
+        },
+        300);
+
+    std::vector<std::int64_t> values(5000);
+    for (std::size_t i = 0; i < values.size(); i++) {
+        values[i] = i * 3;
+    }
+    std::vector<std::int64_t> copy = values;
+    std::unordered_set<std::size_t> seen;
+    for (std::size_t size = 0; size <= values.size(); size += 31) {
+        std::size_t hash =
+            Builder().addRange(values.data(), values.data() + size).hash;
+        ASSERT_EQ(
+            hash,
+            Builder().addRange(copy.data(), copy.data() + size).hash);
+        ASSERT_TRUE(seen.insert(hash).second);
+    }
+
+    // every element counts, wherever it falls in a block
+    std::size_t hash = Builder().addRange(values).hash;
+    for (std::size_t i = 0; i < values.size(); i++) {
+        copy[i] = -1;
+        ASSERT_TRUE(
+            seen.insert(Builder().addRange(copy).hash)
+                .second);
+        copy[i] = values[i];
+    }
+    ASSERT_EQ(Builder().addRange(copy).hash, hash);
+
+    // and so does their order
+    std::swap(copy[0], copy[8]);
+    ASSERT_NE(Builder().addRange(copy).hash, hash);
+
+    // every kernel the cpu supports gives the same hash
+    std::string selected = Builder::rangeKernel();
+    std::vector<std::size_t> expected;
+    for (const char * kernel : {"scalar", "sse2", "avx2"}) {
+        if (!Builder::useRangeKernel(kernel)) {
+            continue;
+        }
+        ASSERT_EQ(Builder::rangeKernel(), std::string(kernel));
+        std::vector<std::size_t> hashes;
+        for (std::size_t size : {300, 1024, 1025, 4000, 40000}) {
+            hashes.push_back(
+                Builder().addRangeBytes(values.data(), size).hash);
+        }
+        if (expected.empty()) {
+            expected = hashes;
+        }
+        ASSERT_EQ(hashes, expected) << kernel;
+    }
+    ASSERT_FALSE(Builder::useRangeKernel("none"));
+    ASSERT_TRUE(Builder::useRangeKernel(selected.c_str()));
+
+    // equal floating point values hash alike, as they do through add()
+    std::vector<double> zeros(100, 0.0);
+    std::vector<double> negativeZeros(100, -0.0);
+    ASSERT_EQ(Builder().addRange(zeros).hash,
+              Builder().addRange(negativeZeros).hash);
+    ASSERT_EQ(Builder().addRange(zeros.data(), zeros.data() + 1).hash,
+              Builder().add(-0.0).hash);
+    ASSERT_NE(Builder().addRange(zeros).hash,
+              Builder().addRange(std::vector<double>(100, 1.0)).hash);
+
+    std::vector<std::shared_ptr<Obj_Example<int>>> objs;
+    std::vector<const Obj_Base *> pointers;
+    for (int i = 0; i < 100; i++) {
+        objs.push_back(Obj::Create<Obj_Example<int>>());
+        pointers.push_back(objs.back().get());
+    }
+    std::vector<std::size_t> hashes(pointers.size());
+    hashMany(pointers.data(), pointers.size(), hashes.data());
+    for (std::size_t i = 0; i < objs.size(); i++) {
+        ASSERT_EQ(hashes[i], objs[i]->hashCode());
+    }
+}
+
+struct Obj_Equals_Point_Test : public Obj {
+        LIBOBJ_BASE(Obj_Equals_Point_Test)
+
+        static int hashed;
+
+        mutable int x = 0;
+        mutable std::string label;
+
+        LIBOBJ_OVERRIDE__EQUALS_FIELDS(Obj_Equals_Point_Test,
+                                       &Obj_Equals_Point_Test::x,
+                                       &Obj_Equals_Point_Test::label)
+
+        LIBOBJ_OVERRIDE__HASHCODE {
+            hashed++;
+            return HashCodeBuilder().add(x).add(label).hash;
+        }
+};
+
+int Obj_Equals_Point_Test::hashed = 0;
+
+struct Obj_Equals_Point3_Test : public Obj_Equals_Point_Test {
+        LIBOBJ_BASE(Obj_Equals_Point3_Test)
+
+        mutable int z = 0;
+
+        LIBOBJ_OVERRIDE__EQUALS_FIELDS(Obj_Equals_Point3_Test,
+                                       &Obj_Equals_Point3_Test::z)
+};
+
+struct Obj_Equals_Cached_Test : public Obj {
+        LIBOBJ_BASE(Obj_Equals_Cached_Test)
+
+        static int compared;
+
+        struct Counted {
+                int value = 0;
+                bool operator==(const Counted & other) const {
+                    compared++;
+                    return value == other.value;
+                }
+        };
+
+        mutable Counted value;
+
+        void set(int v) const {
+            value.value = v;
+            markDirty();
+        }
+
+        LIBOBJ_OVERRIDE__EQUALS_FIELDS(Obj_Equals_Cached_Test,
+                                       &Obj_Equals_Cached_Test::value)
+
+        LIBOBJ_OVERRIDE__CACHED_HASHCODE(Obj_Equals_Cached_Test) {
+            return HashCodeBuilder().add(value.value).hash;
+        }
+};
+
+int Obj_Equals_Cached_Test::compared = 0;
+
+// has state but no field list, its == compares hashCode()
+struct Obj_Equals_Hashed_Base_Test : public Obj {
+        LIBOBJ_BASE(Obj_Equals_Hashed_Base_Test)
+
+        mutable int s = 0;
+
+        LIBOBJ_OVERRIDE__HASHCODE {
+            return HashCodeBuilder().add(s).hash;
+        }
+};
+
+struct Obj_Equals_Hashed_Test : public Obj_Equals_Hashed_Base_Test {
+        LIBOBJ_BASE(Obj_Equals_Hashed_Test)
+
+        mutable int z = 0;
+
+        LIBOBJ_OVERRIDE__EQUALS_FIELDS(Obj_Equals_Hashed_Test,
+                                       &Obj_Equals_Hashed_Test::z)
+};
+
+TEST(libobj, structural_equals) {
+    Obj_Equals_Point_Test a, b;
+    a.x = b.x = 1;
+    a.label = b.label = "a";
+    ASSERT_TRUE(a == b);
+    b.label = "b";
+    ASSERT_FALSE(a == b);
+    ASSERT_TRUE(a != b);
+    ASSERT_EQ(Obj_Equals_Point_Test::hashed, 0);
+
+    // the fields of the parent count, and the types must match
+    Obj_Equals_Point3_Test c, d;
+    ASSERT_TRUE(c == d);
+    d.z = 1;
+    ASSERT_FALSE(c == d);
+    d.z = 0;
+    d.x = 1;
+    ASSERT_FALSE(c == d);
+    Obj_Equals_Point_Test e;
+    ASSERT_FALSE(c == e);
+    ASSERT_FALSE(e == c);
+    ASSERT_TRUE(c == static_cast<const Obj_Base &>(c));
+
+    // kept hash codes rule out unequal objects without comparing fields
+    Obj_Equals_Cached_Test f, g;
+    f.set(1);
+    g.set(2);
+    f.hashCode();
+    g.hashCode();
+    ASSERT_FALSE(f == g);
+    ASSERT_EQ(Obj_Equals_Cached_Test::compared, 0);
+    g.set(1);
+    ASSERT_TRUE(f == g);
+    ASSERT_EQ(Obj_Equals_Cached_Test::compared, 1);
+
+    // the state of a parent without a field list is compared via its hash
+    Obj_Equals_Hashed_Test h, i;
+    ASSERT_TRUE(h == i);
+    h.s = 1;
+    i.s = 2;
+    ASSERT_FALSE(h == i);
+    i.s = 1;
+    ASSERT_TRUE(h == i);
+    i.z = 1;
+    ASSERT_FALSE(h == i);
+
+    // the default no longer equates objects of different types
+    Obj o;
+    ASSERT_TRUE(o == o);
+    ASSERT_FALSE(o == a);
+}
+
+struct Obj_Intern_Test : public Obj {
+        LIBOBJ_BASE(Obj_Intern_Test)
+
+        mutable int value = 0;
+
+        LIBOBJ_OVERRIDE__FROM_COPY {
+            value = other.as<Obj_Intern_Test>().value;
+        }
+
+        LIBOBJ_OVERRIDE__EQUALS_FIELDS(Obj_Intern_Test, &Obj_Intern_Test::value)
+
+        LIBOBJ_OVERRIDE__HASHCODE {
+            return HashCodeBuilder().add(value).hash;
+        }
+};
+
+TEST(libobj, interner) {
+    ObjInterner<Obj_Intern_Test> interner;
+    Obj_Intern_Test one;
+    one.value = 1;
+    Obj_Intern_Test other;
+    other.value = 1;
+
+    auto a = interner.intern(one);
+    auto b = interner.intern(other);
+    ASSERT_EQ(a, b);
+    ASSERT_NE(a.get(), &one);
+    ASSERT_EQ(a->value, 1);
+    ASSERT_EQ(interner.find(other), a);
+
+    // an owned object becomes canonical without a copy
+    auto owned = Obj::Create<Obj_Intern_Test>();
+    owned->value = 2;
+    auto c = interner.intern(owned);
+    ASSERT_EQ(c, owned);
+    ASSERT_NE(c, a);
+    ASSERT_EQ(interner.size(), 2u);
+
+    // canonical objects only live as long as their handles
+    owned.reset();
+    c.reset();
+    Obj_Intern_Test two;
+    two.value = 2;
+    ASSERT_EQ(interner.find(two), nullptr);
+    ASSERT_EQ(interner.size(), 1u);
+    ASSERT_EQ(interner.purge(), 1u);
+    ASSERT_EQ(interner.purge(), 0u);
+
+    // dead entries are swept as the table grows
+    for (int i = 0; i < 10000; i++) {
+        Obj_Intern_Test t;
+        t.value = 100 + i;
+        interner.intern(t);
+    }
+    // with a single live object, no shard holds more than 64 entries
+    ASSERT_EQ(interner.size(), 1u);
+    ASSERT_LE(interner.purge(), 16u * 64u);
+
+    ASSERT_EQ(interner.intern(std::shared_ptr<const Obj_Intern_Test>()),
+              nullptr);
+
+    // every thread gets the same canonical object for the same value
+    const int threads = 4;
+    const int values = 200;
+    std::vector<std::future<std::vector<std::shared_ptr<const Obj_Intern_Test>>>>
+        results;
+    for (int t = 0; t < threads; t++) {
+        results.push_back(std::async(std::launch::async, [&interner, values] {
+            std::vector<std::shared_ptr<const Obj_Intern_Test>> out;
+            for (int i = 0; i < values; i++) {
+                Obj_Intern_Test v;
+                v.value = i;
+                out.push_back(interner.intern(v));
+            }
+            return out;
+        }));
+    }
+    auto first = results[0].get();
+    for (int t = 1; t < threads; t++) {
+        ASSERT_EQ(results[t].get(), first);
+    }
+    ASSERT_EQ(interner.size(), std::size_t(values));
+}